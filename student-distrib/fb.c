@@ -0,0 +1,315 @@
+#include "fb.h"
+#include "system_calls.h"
+
+/* VGA registers the VBE mode changes, put back when leaving graphics mode */
+#define VGA_SEQ_INDEX		0x3C4
+#define VGA_GFX_INDEX		0x3CE
+#define VGA_CRTC_INDEX		0x3D4
+#define VGA_CRTC_PROTECT	0x11
+#define VGA_CRTC_LOCK		0x80
+
+static const uint8_t seq_regs[] = {0x02, 0x04};
+static const uint8_t gfx_regs[] = {0x05, 0x06};
+static const uint8_t crtc_regs[] = {0x01, 0x07, 0x09, 0x12, 0x13, 0x17, 0x18};
+
+static uint8_t seq_saved[sizeof(seq_regs)];
+static uint8_t gfx_saved[sizeof(gfx_regs)];
+static uint8_t crtc_saved[sizeof(crtc_regs)];
+
+/* physical address of the framebuffer, 0 without a VBE interface */
+static uint32_t fb_lfb = 0;
+/* process that has the framebuffer mapped, -1 for none */
+static int32_t fb_owner = -1;
+static uint32_t fb_width, fb_height, fb_pitch;
+/* the framebuffer where the owner sees it, the kernel draws through it too */
+static uint32_t* fb_pixels;
+
+/*
+ * vbe_read / vbe_write
+ * DESCRIPTION: Access a Bochs dispi register
+ * INPUT: reg - register index
+ * 		  val - value to write
+ * OUTPUT: n/a
+ * RETURNS: the register for vbe_read
+ * SIDE EFFECTS: none
+ */
+static uint16_t vbe_read (uint16_t reg) {
+	outw(reg, VBE_INDEX_PORT);
+	return inw(VBE_DATA_PORT);
+}
+
+static void vbe_write (uint16_t reg, uint16_t val) {
+	outw(reg, VBE_INDEX_PORT);
+	outw(val, VBE_DATA_PORT);
+}
+
+/*
+ * pci_read
+ * DESCRIPTION: Reads a dword of a bus 0 device's configuration space
+ * INPUT: dev - device number
+ * 		  off - dword aligned register offset
+ * OUTPUT: n/a
+ * RETURNS: the register, all ones for no device
+ * SIDE EFFECTS: none
+ */
+static uint32_t pci_read (uint32_t dev, uint32_t off) {
+	outl(PCI_ENABLE | (dev << 11) | off, PCI_CONFIG_ADDR);
+	return inl(PCI_CONFIG_DATA);
+}
+
+/*
+ * vga_regs
+ * DESCRIPTION: Saves or restores an indexed group of VGA registers
+ * INPUT: port - index port, the data port follows it
+ * 		  regs - register indices
+ * 		  saved - values
+ * 		  n - number of registers
+ * 		  save - 1 to save, 0 to restore
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: none
+ */
+static void vga_regs (uint16_t port, const uint8_t* regs, uint8_t* saved, uint32_t n, int32_t save) {
+	uint32_t i;
+
+	for(i = 0; i < n; i++){
+		outb(regs[i], port);
+		if(save)
+			saved[i] = inb(port + 1);
+		else
+			outb(saved[i], port + 1);
+	}
+}
+
+/*
+ * vga_save / vga_restore
+ * DESCRIPTION: Keep the text mode registers the VBE mode overwrites. CRTC
+ * 				registers 0 to 7 are write protected in text mode, so the
+ * 				lock is lifted while they are put back
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: none
+ */
+static void vga_save (void) {
+	vga_regs(VGA_SEQ_INDEX, seq_regs, seq_saved, sizeof(seq_regs), 1);
+	vga_regs(VGA_GFX_INDEX, gfx_regs, gfx_saved, sizeof(gfx_regs), 1);
+	vga_regs(VGA_CRTC_INDEX, crtc_regs, crtc_saved, sizeof(crtc_regs), 1);
+}
+
+static void vga_restore (void) {
+	uint8_t protect;
+
+	vga_regs(VGA_SEQ_INDEX, seq_regs, seq_saved, sizeof(seq_regs), 0);
+	vga_regs(VGA_GFX_INDEX, gfx_regs, gfx_saved, sizeof(gfx_regs), 0);
+	outb(VGA_CRTC_PROTECT, VGA_CRTC_INDEX);
+	protect = inb(VGA_CRTC_INDEX + 1);
+	outb(protect & ~VGA_CRTC_LOCK, VGA_CRTC_INDEX + 1);
+	vga_regs(VGA_CRTC_INDEX, crtc_regs, crtc_saved, sizeof(crtc_regs), 0);
+	outb(VGA_CRTC_PROTECT, VGA_CRTC_INDEX);
+	outb(protect, VGA_CRTC_INDEX + 1);
+}
+
+/*
+ * fb_text_mode
+ * DESCRIPTION: Turns the VBE mode off and gives the display back to the terminals
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: unmaps the framebuffer, frees it for the next fb_map
+ */
+static void fb_text_mode (void) {
+	vbe_write(VBE_ENABLE, 0);
+	vga_restore();
+	unmap_fb_pages();
+	if(pcb_ptr_array[fb_owner] != NULL)
+		pcb_ptr_array[fb_owner]->fb_mapped = 0;
+	fb_owner = -1;
+}
+
+/*
+ * fb_clip
+ * DESCRIPTION: Checks a rectangle from the caller and clips it to the screen
+ * INPUT: rect - the caller's rectangle
+ * 		  w, h - set to the size left after clipping
+ * OUTPUT: n/a
+ * RETURNS: -1 if the caller does not own the framebuffer or rect is a bad
+ * 			pointer, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+static int32_t fb_clip (const fb_rect_t* rect, uint32_t* w, uint32_t* h) {
+	if(fb_owner != cur_pid)
+		return -1;
+	if((uint32_t)rect < MB128 || (uint32_t)rect > MB132 - sizeof(fb_rect_t))
+		return -1;
+
+	*w = 0;
+	*h = 0;
+	if(rect->x < fb_width && rect->y < fb_height){
+		*w = (rect->width < fb_width - rect->x) ? rect->width : fb_width - rect->x;
+		*h = (rect->height < fb_height - rect->y) ? rect->height : fb_height - rect->y;
+	}
+	return 0;
+}
+
+/*
+ * fb_init (void)
+ * DESCRIPTION: Looks for the Bochs dispi interface and asks PCI where QEMU's
+ * 				standard VGA put its framebuffer, Bochs uses a fixed address
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: fb_map fails if nothing was found
+ */
+void fb_init (void) {
+	uint16_t id = vbe_read(VBE_ID);
+	uint32_t dev;
+
+	fb_lfb = 0;
+	if(id < VBE_ID_LFB || id > VBE_ID_MAX)
+		return;
+
+	fb_lfb = VBE_LFB_DEFAULT;
+	for(dev = 0; dev < PCI_DEVICES; dev++){
+		if(pci_read(dev, 0) == BOCHS_VGA_ID){
+			fb_lfb = pci_read(dev, PCI_BAR0) & PCI_BAR_MEM_MASK;
+			break;
+		}
+	}
+}
+
+/*
+ * fb_map_c (uint32_t width, uint32_t height, fb_info_t* info)
+ * DESCRIPTION: Switches the display to width x height at FB_BPP and maps the
+ * 				framebuffer at FB_ADDR for the current process, cleared to
+ * 				black. The picture starts past the text planes and font at the
+ * 				start of video memory, so text mode comes back intact. The owner
+ * 				can call it again to change the mode
+ * INPUT: width, height - mode, width a multiple of 8
+ * 		  info - filled in with the layout of the framebuffer
+ * OUTPUT: n/a
+ * RETURNS: -1 for no VBE, a bad mode or pointer or another owner, 0 on success
+ * SIDE EFFECTS: text output to the terminals is not shown until the owner halts
+ */
+int32_t fb_map_c (uint32_t width, uint32_t height, fb_info_t* info) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	uint32_t pitch, y_offset, flags;
+
+	if(fb_lfb == 0)
+		return -1;
+	if((uint32_t)info < MB128 || (uint32_t)info > MB132 - sizeof(fb_info_t))
+		return -1;
+	if(width == 0 || height == 0 || width > FB_MAX_WIDTH || height > FB_MAX_HEIGHT || (width & 7))
+		return -1;
+
+	cli_and_save(flags);
+	if(fb_owner != -1 && fb_owner != cur_pid){
+		restore_flags(flags);
+		return -1;
+	}
+	fb_owner = cur_pid;
+	restore_flags(flags);
+
+	pitch = width * (FB_BPP / 8);
+	y_offset = (FB_TEXT_RESERVED + pitch - 1) / pitch;
+
+	if(!pcb->fb_mapped)
+		vga_save();
+	vbe_write(VBE_ENABLE, 0);
+	vbe_write(VBE_XRES, width);
+	vbe_write(VBE_YRES, height);
+	vbe_write(VBE_BPP, FB_BPP);
+	vbe_write(VBE_ENABLE, VBE_ENABLED | VBE_LFB_ENABLED | VBE_NOCLEARMEM);
+	vbe_write(VBE_VIRT_WIDTH, width);
+	vbe_write(VBE_X_OFFSET, 0);
+	vbe_write(VBE_Y_OFFSET, y_offset);
+
+	// the adapter clamps what it can't do, too little video memory for the offset
+	if(vbe_read(VBE_XRES) != width || vbe_read(VBE_YRES) != height
+		|| vbe_read(VBE_Y_OFFSET) != y_offset){
+		fb_text_mode();
+		return -1;
+	}
+
+	fb_width = width;
+	fb_height = height;
+	fb_pitch = pitch;
+	fb_pixels = (uint32_t*)map_fb_pages(fb_lfb + y_offset * pitch, pitch * height);
+	pcb->fb_mapped = 1;
+	memset_dword(fb_pixels, 0, (pitch / 4) * height);
+
+	info->width = width;
+	info->height = height;
+	info->pitch = pitch;
+	info->bpp = FB_BPP;
+	info->pixels = fb_pixels;
+	return 0;
+}
+
+/*
+ * fb_fill_c (const fb_rect_t* rect, uint32_t color)
+ * DESCRIPTION: Fills a rectangle of the screen with one color, a rep stosl per row
+ * INPUT: rect - where, src is not used
+ * 		  color - 0x00RRGGBB
+ * OUTPUT: n/a
+ * RETURNS: -1 if the caller does not own the framebuffer or rect is bad, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+int32_t fb_fill_c (const fb_rect_t* rect, uint32_t color) {
+	uint32_t w, h, row;
+	uint32_t* dest;
+
+	if(fb_clip(rect, &w, &h) == -1)
+		return -1;
+
+	dest = fb_pixels + rect->y * (fb_pitch / 4) + rect->x;
+	for(row = 0; row < h; row++, dest += fb_pitch / 4)
+		memset_dword(dest, color, w);
+	return 0;
+}
+
+/*
+ * fb_blit_c (const fb_rect_t* rect)
+ * DESCRIPTION: Copies pixels from the caller's memory to a rectangle of the
+ * 				screen, a memcpy per row
+ * INPUT: rect - where, src and src_pitch say where the pixels come from
+ * OUTPUT: n/a
+ * RETURNS: -1 if the caller does not own the framebuffer or rect or its
+ * 			pixels are bad, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+int32_t fb_blit_c (const fb_rect_t* rect) {
+	uint32_t w, h, row;
+	uint32_t* dest;
+	const uint32_t* src;
+
+	if(fb_clip(rect, &w, &h) == -1)
+		return -1;
+	if(w == 0 || h == 0)
+		return 0;
+
+	// every row read has to be in the program's memory
+	src = rect->src;
+	if((uint32_t)src < MB128 || (uint32_t)src >= MB132 || ((uint32_t)src & 3)
+		|| rect->src_pitch < w || rect->src_pitch > (MB132 - MB128) / 4
+		|| (h - 1) * rect->src_pitch + w > (MB132 - (uint32_t)src) / 4)
+		return -1;
+
+	dest = fb_pixels + rect->y * (fb_pitch / 4) + rect->x;
+	for(row = 0; row < h; row++, dest += fb_pitch / 4, src += rect->src_pitch)
+		memcpy(dest, src, w * 4);
+	return 0;
+}
+
+/*
+ * fb_release (int32_t pid)
+ * DESCRIPTION: Goes back to text mode if pid owns the framebuffer
+ * INPUT: pid - halting process
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: see fb_text_mode
+ */
+void fb_release (int32_t pid) {
+	if(fb_owner == pid)
+		fb_text_mode();
+}
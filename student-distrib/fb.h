@@ -0,0 +1,50 @@
+#ifndef _FB_H
+#define _FB_H
+
+#include "types.h"
+#include "fb_data.h"
+
+/* Bochs dispi registers, selected through the index port */
+#define VBE_INDEX_PORT		0x01CE
+#define VBE_DATA_PORT		0x01CF
+#define VBE_ID				0
+#define VBE_XRES			1
+#define VBE_YRES			2
+#define VBE_BPP				3
+#define VBE_ENABLE			4
+#define VBE_VIRT_WIDTH		6
+#define VBE_X_OFFSET		8
+#define VBE_Y_OFFSET		9
+/* first interface version with 32 bpp and the linear framebuffer */
+#define VBE_ID_LFB			0xB0C2
+#define VBE_ID_MAX			0xB0CF
+#define VBE_ENABLED			0x01
+#define VBE_LFB_ENABLED		0x40
+#define VBE_NOCLEARMEM		0x80
+/* where Bochs puts the framebuffer when there is no PCI device to ask */
+#define VBE_LFB_DEFAULT		0xE0000000
+
+/* PCI configuration space, the framebuffer is BAR 0 of QEMU's standard VGA */
+#define PCI_CONFIG_ADDR		0xCF8
+#define PCI_CONFIG_DATA		0xCFC
+#define PCI_ENABLE			0x80000000
+#define PCI_DEVICES			32
+#define PCI_BAR0			0x10
+#define PCI_BAR_MEM_MASK	0xFFFFFFF0
+#define BOCHS_VGA_ID		0x11111234
+
+/* the text planes and font live at the start of video memory, the picture starts after them */
+#define FB_TEXT_RESERVED	0x40000
+
+/* looks for the VBE interface and the framebuffer */
+extern void fb_init (void);
+/* sets the mode and maps the framebuffer for the current process */
+extern int32_t fb_map_c (uint32_t width, uint32_t height, fb_info_t* info);
+/* fills a rectangle with one color */
+extern int32_t fb_fill_c (const fb_rect_t* rect, uint32_t color);
+/* copies a rectangle of pixels from the caller to the screen */
+extern int32_t fb_blit_c (const fb_rect_t* rect);
+/* back to text mode if pid owns the framebuffer, used by halt */
+extern void fb_release (int32_t pid);
+
+#endif /* _FB_H */
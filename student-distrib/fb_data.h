@@ -0,0 +1,41 @@
+#ifndef _FB_DATA_H
+#define _FB_DATA_H
+
+/*
+    Linear framebuffer through the Bochs/QEMU VBE (dispi) registers. fb_map
+    switches the display to width x height at 32 bits per pixel, maps the
+    framebuffer into the caller at FB_ADDR and fills in an fb_info_t. One
+    process owns the framebuffer at a time, halting it puts the display back
+    in text mode. fb_fill and fb_blit draw rectangles in the kernel with one
+    string move per row, anything outside the screen is clipped. Pixels are
+    0x00RRGGBB. Shared with ../syscalls, the includer provides uint32_t.
+*/
+
+// page directory entries 36 to 39, above the shared memory window
+#define FB_ADDR         0x9000000
+#define FB_WINDOW       0x1000000
+#define FB_BPP          32
+// widths have to be a multiple of 8 for the VGA
+#define FB_MAX_WIDTH    1920
+#define FB_MAX_HEIGHT   1200
+
+typedef struct fb_info{
+    uint32_t width;
+    uint32_t height;
+    // bytes from one row to the next
+    uint32_t pitch;
+    uint32_t bpp;
+    uint32_t* pixels;
+} fb_info_t;
+
+typedef struct fb_rect{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    // fb_blit only: pixels to copy and pixels from one of their rows to the next
+    const uint32_t* src;
+    uint32_t src_pitch;
+} fb_rect_t;
+
+#endif /* _FB_DATA_H */
@@ -15,5 +15,14 @@ extern void RTC_interrupt();
   wrapper of PIT handler*/
 extern void PIT_interrupt();
 
+/*wrappers of the exceptions that become signals in user mode,
+  they pass the saved hw_context_t to the C handler*/
+extern void divide_error_interrupt();
+extern void general_protection_interrupt();
+extern void page_fault_interrupt();
+
+/*jumped to by the system call paths when signal_work is set*/
+extern void syscall_signal_return();
+
 #endif
 #endif
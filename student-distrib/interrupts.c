@@ -20,7 +20,7 @@ void intialize_interrupts(){
 	/* TRAPS are software-generated interrupts
 	while INTs are hardware-generated and unpredictable */
 	/* Privelege level comes from linux standardization */
-	init_trap_gate(0, &divide_error_exception, PRIVILEGED);
+	init_trap_gate(0, &divide_error_interrupt, PRIVILEGED);
 	init_trap_gate(1, &debug_exception, PRIVILEGED);
 	init_int_gate (2, &NMI_interrupt, PRIVILEGED);
 	init_int_gate (3, &breakpoint_exception, UNPRIVILEGED);
@@ -33,8 +33,8 @@ void intialize_interrupts(){
 	init_trap_gate(10, &invalid_TSS_exception, PRIVILEGED);
 	init_trap_gate(11, &segment_not_present_exception, PRIVILEGED);
 	init_trap_gate(12, &stack_segment_fault_exception, PRIVILEGED);
-	init_trap_gate(13, &general_protection_exception, PRIVILEGED);
-	init_trap_gate(14, &page_fault_exception, PRIVILEGED);
+	init_trap_gate(13, &general_protection_interrupt, PRIVILEGED);
+	init_trap_gate(14, &page_fault_interrupt, PRIVILEGED);
 	init_trap_gate(16, &FPU_floating_point_error_exception, PRIVILEGED);
 	init_trap_gate(17, &alignment_check_exception, PRIVILEGED);
 	init_trap_gate(18, &machine_check_exception, PRIVILEGED);
@@ -155,11 +155,15 @@ void init_int_gate(int vector, void* func, int priv) {
 }
 
 
-/* void divide_error_exception(void);
- * Inputs: void
+/* void divide_error_exception(hw_context_t* ctx);
+ * Inputs: ctx - registers saved by divide_error_interrupt
  * Return Value: none
- * Function: Shows BSOD for interrupt vector 0 */
-void divide_error_exception() {
+ * Function: Sends SIG_DIV_ZERO for a user mode fault, shows BSOD for interrupt vector 0 */
+void divide_error_exception(hw_context_t* ctx) {
+	if(ctx->cs & RPL_MASK){
+		signal_fault(SIG_DIV_ZERO);
+		return;
+	}
 	if(pcb_ptr_array[cur_pid] != NULL){
 		pcb_ptr_array[cur_pid]->error_flag = 1;
 	}
@@ -317,11 +321,15 @@ void stack_segment_fault_exception() {
 
 }
 
-/* void general_protection_exception(void);
- * Inputs: void
+/* void general_protection_exception(hw_context_t* ctx);
+ * Inputs: ctx - registers saved by general_protection_interrupt
  * Return Value: none
- * Function: Shows BSOD for interrupt vector 13 */
-void general_protection_exception() {
+ * Function: Sends SIG_SEGFAULT for a user mode fault, shows BSOD for interrupt vector 13 */
+void general_protection_exception(hw_context_t* ctx) {
+	if(ctx->cs & RPL_MASK){
+		signal_fault(SIG_SEGFAULT);
+		return;
+	}
 	if(pcb_ptr_array[cur_pid] != NULL){
 		pcb_ptr_array[cur_pid]->error_flag = 14;
 	}
@@ -330,11 +338,15 @@ void general_protection_exception() {
 
 }
 
-/* void page_fault_exception(void);
- * Inputs: void
+/* void page_fault_exception(hw_context_t* ctx);
+ * Inputs: ctx - registers saved by page_fault_interrupt
  * Return Value: none
- * Function: Shows BSOD for interrupt vector 14 */
-void page_fault_exception() {
+ * Function: Sends SIG_SEGFAULT for a user mode fault, shows BSOD for interrupt vector 14 */
+void page_fault_exception(hw_context_t* ctx) {
+	if(ctx->cs & RPL_MASK){
+		signal_fault(SIG_SEGFAULT);
+		return;
+	}
 	if(pcb_ptr_array[cur_pid] != NULL){
 		pcb_ptr_array[cur_pid]->error_flag = 15;
 	}
@@ -9,6 +9,7 @@
 //#include "i8259.h"
 //#include "rtc.h"
 #include "system_calls_asm.h"
+#include "signal.h"
 //#include "system_calls.h"
 
 
@@ -30,7 +31,7 @@ extern void init_trap_gate(int vector, void* func, int priv);
 extern void init_int_gate_unused(int vector, void* func, int priv);
 extern void init_int_gate(int vector, void* func, int priv);
 
-extern void divide_error_exception();
+extern void divide_error_exception(hw_context_t* ctx);
 
 extern void debug_exception();
 
@@ -56,9 +57,9 @@ extern void segment_not_present_exception();
 
 extern void stack_segment_fault_exception();
 
-extern void general_protection_exception();
+extern void general_protection_exception(hw_context_t* ctx);
 
-extern void page_fault_exception();
+extern void page_fault_exception(hw_context_t* ctx);
 
 extern void FPU_floating_point_error_exception();
 
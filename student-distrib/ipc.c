@@ -0,0 +1,265 @@
+#include "ipc.h"
+#include "system_calls.h"
+#include "sched.h"
+
+/*
+	Messages are staged in kernel memory because sender and receiver never
+	have their pages mapped at the same time. A sender that finds its
+	receiver waiting writes into the receiver's slot and switches straight
+	to it. Otherwise it leaves the message in its own slot and blocks until
+	the receiver copies it out. Like the pipes, this runs with interrupts
+	disabled so a wakeup can't get lost
+*/
+typedef struct ipc_slot{
+	int32_t sender;
+	uint32_t words[IPC_WORDS];
+	uint32_t len;
+	uint8_t data[IPC_BUF_MAX];
+} ipc_slot_t;
+
+static ipc_slot_t slots[MAX_PCBS];
+
+/*
+ * ipc_msg_ok
+ * DESCRIPTION: Checks a user message and the buffer it names
+ * INPUT: msg - user message
+ * OUTPUT: n/a
+ * RETURNS: 1 if both are inside the program's page
+ * SIDE EFFECTS: none
+ */
+static int32_t ipc_msg_ok (ipc_msg_t* msg) {
+	if((uint32_t)msg < MB128 || (uint32_t)msg + sizeof(ipc_msg_t) > MB132)
+		return 0;
+	if(msg->len > IPC_BUF_MAX)
+		return 0;
+	return msg->len == 0 || (msg->buf >= MB128 && msg->buf + msg->len <= MB132);
+}
+
+/*
+ * ipc_stage
+ * DESCRIPTION: Copies a message from the current process into a slot
+ * INPUT: slot - where it goes
+ * 		  msg - user message of the current process
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: none
+ */
+static void ipc_stage (ipc_slot_t* slot, ipc_msg_t* msg) {
+	slot->sender = cur_pid;
+	memcpy(slot->words, msg->words, sizeof(slot->words));
+	slot->len = msg->len;
+	memcpy(slot->data, (void*)msg->buf, msg->len);
+}
+
+/*
+ * ipc_unstage
+ * DESCRIPTION: Copies a slot out to the current process
+ * INPUT: slot - staged message
+ * 		  msg - user message to fill in
+ * 		  cap - room in the user buffer, read before the process blocked
+ * OUTPUT: n/a
+ * RETURNS: pid that sent the message
+ * SIDE EFFECTS: none
+ */
+static int32_t ipc_unstage (ipc_slot_t* slot, ipc_msg_t* msg, uint32_t cap) {
+	uint32_t len = (slot->len < cap) ? slot->len : cap;
+
+	memcpy(msg->words, slot->words, sizeof(msg->words));
+	memcpy((void*)msg->buf, slot->data, len);
+	msg->len = len;
+	return slot->sender;
+}
+
+/*
+ * ipc_wait
+ * DESCRIPTION: Blocks until another process moves us back to IPC_IDLE,
+ * 				called with interrupts disabled
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: 0 once the exchange finished, -1 if the peer halted or a
+ * 			signal is about to kill us
+ * SIDE EFFECTS: interrupts are enabled again on return
+ */
+static int32_t ipc_wait (void) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+
+	while(pcb->ipc_state != IPC_IDLE){
+		if(signal_fatal_pending(cur_pid) || (pcb->ipc_peer != IPC_ANY && pcb_ptr_array[pcb->ipc_peer] == NULL)){
+			pcb->ipc_state = IPC_IDLE;
+			sti();
+			return -1;
+		}
+		sched_block();
+		cli();
+	}
+	sti();
+	return 0;
+}
+
+/*
+ * ipc_valid_peer
+ * DESCRIPTION: Checks a pid the current process wants to talk to
+ * INPUT: pid - the other process
+ * OUTPUT: n/a
+ * RETURNS: 1 if it is another live process
+ * SIDE EFFECTS: none
+ */
+static int32_t ipc_valid_peer (int32_t pid) {
+	return pid >= 0 && pid < MAX_PCBS && pid != cur_pid && pcb_ptr_array[pid] != NULL;
+}
+
+/*
+ * ipc_send
+ * DESCRIPTION: Common part of send and call. A receiver already waiting
+ * 				gets the message and the processor right away, bypassing the
+ * 				run queues. A caller stays blocked for the answer
+ * INPUT: dest - receiver
+ * 		  msg - user message, also gets the answer for a call
+ * 		  calling - 1 for call
+ * OUTPUT: n/a
+ * RETURNS: 0 on success, -1 if dest halted or a signal came first
+ * SIDE EFFECTS: switches to dest if it was waiting
+ */
+static int32_t ipc_send (int32_t dest, ipc_msg_t* msg, uint8_t calling) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	pcb_t* dst;
+	uint32_t cap = msg->len;
+
+	cli();
+	dst = pcb_ptr_array[dest];
+	if(dst != NULL && dst->ipc_state == IPC_RECEIVING && (dst->ipc_peer == IPC_ANY || dst->ipc_peer == cur_pid)){
+		ipc_stage(&slots[dest], msg);
+		dst->ipc_state = IPC_IDLE;
+		if(!calling){
+			// we stay runnable, dest just goes first
+			sched_yield_to(dest);
+			return 0;
+		}
+		pcb->ipc_state = IPC_RECEIVING;
+		pcb->ipc_peer = dest;
+		sched_handoff(dest);
+		cli();
+	}
+	else{
+		ipc_stage(&slots[cur_pid], msg);
+		pcb->ipc_state = calling ? IPC_CALLING : IPC_SENDING;
+		pcb->ipc_peer = dest;
+	}
+
+	// a receiver that takes a call moves us on to IPC_RECEIVING, the answer ends the wait
+	if(ipc_wait() == -1)
+		return -1;
+	if(calling)
+		ipc_unstage(&slots[cur_pid], msg, cap);
+	return 0;
+}
+
+/*
+ * ipc_send_c (int32_t dest, ipc_msg_t* msg)
+ * DESCRIPTION: Sends a message and waits until the receiver has it
+ * INPUT: dest - pid of the receiver
+ * 		  msg - words and optional buffer to send
+ * OUTPUT: n/a
+ * RETURNS: 0 on success, -1 for a bad pid or message or if dest halted
+ * SIDE EFFECTS: may switch to the receiver
+ */
+int32_t ipc_send_c (int32_t dest, ipc_msg_t* msg) {
+	if(!ipc_valid_peer(dest) || !ipc_msg_ok(msg))
+		return -1;
+	return ipc_send(dest, msg, 0);
+}
+
+/*
+ * ipc_call_c (int32_t dest, ipc_msg_t* msg)
+ * DESCRIPTION: Sends a message and waits for dest to answer with a send
+ * INPUT: dest - pid of the server
+ * 		  msg - the request, replaced by the answer. len is the request's
+ * 				length going out and the room for the answer coming back
+ * OUTPUT: n/a
+ * RETURNS: 0 on success, -1 for a bad pid or message or if dest halted
+ * SIDE EFFECTS: blocks until the answer
+ */
+int32_t ipc_call_c (int32_t dest, ipc_msg_t* msg) {
+	if(!ipc_valid_peer(dest) || !ipc_msg_ok(msg))
+		return -1;
+	return ipc_send(dest, msg, 1);
+}
+
+/*
+ * ipc_recv_c (int32_t from, ipc_msg_t* msg)
+ * DESCRIPTION: Takes a message from a blocked sender or waits for one. A
+ * 				sender that used call is left waiting for the answer
+ * INPUT: from - pid to receive from, IPC_ANY for anyone
+ * 		  msg - gets the words, and data into buf up to len bytes
+ * OUTPUT: n/a
+ * RETURNS: pid of the sender, -1 for a bad pid or message, if from
+ * 			halted or a signal came first
+ * SIDE EFFECTS: wakes a plain sender
+ */
+int32_t ipc_recv_c (int32_t from, ipc_msg_t* msg) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	pcb_t* src;
+	uint32_t cap;
+	int32_t i;
+
+	if((from != IPC_ANY && !ipc_valid_peer(from)) || !ipc_msg_ok(msg))
+		return -1;
+	cap = msg->len;
+
+	cli();
+	for(i = 0; i < MAX_PCBS; i++){
+		src = pcb_ptr_array[i];
+		if(src == NULL || (from != IPC_ANY && from != i) || src->ipc_peer != cur_pid
+			|| (src->ipc_state != IPC_SENDING && src->ipc_state != IPC_CALLING))
+			continue;
+		if(src->ipc_state == IPC_CALLING){
+			src->ipc_state = IPC_RECEIVING;
+		}
+		else{
+			src->ipc_state = IPC_IDLE;
+			sched_wake(i);
+		}
+		sti();
+		return ipc_unstage(&slots[i], msg, cap);
+	}
+
+	pcb->ipc_state = IPC_RECEIVING;
+	pcb->ipc_peer = from;
+	if(ipc_wait() == -1)
+		return -1;
+	return ipc_unstage(&slots[cur_pid], msg, cap);
+}
+
+/*
+ * getpid_c (void)
+ * DESCRIPTION: Tells a program its pid, which is its IPC address
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: pid of the calling process
+ * SIDE EFFECTS: none
+ */
+int32_t getpid_c (void) {
+	return cur_pid;
+}
+
+/*
+ * ipc_exit
+ * DESCRIPTION: Wakes everything blocked on the halting process, they see
+ * 				it gone and fail their call
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: none
+ */
+void ipc_exit (void) {
+	uint32_t flags;
+	int32_t i;
+
+	cli_and_save(flags);
+	for(i = 0; i < MAX_PCBS; i++){
+		if(pcb_ptr_array[i] != NULL && i != cur_pid && pcb_ptr_array[i]->ipc_state != IPC_IDLE
+			&& pcb_ptr_array[i]->ipc_peer == cur_pid)
+			sched_wake(i);
+	}
+	restore_flags(flags);
+}
@@ -0,0 +1,24 @@
+#ifndef _IPC_H
+#define _IPC_H
+
+#include "types.h"
+#include "ipc_data.h"
+
+/* pcb_t.ipc_state, what a process is blocked on */
+#define IPC_IDLE		0
+#define IPC_SENDING		1
+#define IPC_CALLING		2
+#define IPC_RECEIVING	3
+
+/* sends msg to dest, returns once dest has it */
+extern int32_t ipc_send_c (int32_t dest, ipc_msg_t* msg);
+/* waits for a message from pid from or IPC_ANY, returns the sender's pid */
+extern int32_t ipc_recv_c (int32_t from, ipc_msg_t* msg);
+/* sends msg to dest and waits for its answer, which replaces msg */
+extern int32_t ipc_call_c (int32_t dest, ipc_msg_t* msg);
+/* pid of the calling process */
+extern int32_t getpid_c (void);
+/* wakes processes waiting on the current one, used by halt */
+extern void ipc_exit (void);
+
+#endif /* _IPC_H */
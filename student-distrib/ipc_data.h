@@ -0,0 +1,25 @@
+#ifndef _IPC_DATA_H
+#define _IPC_DATA_H
+
+/*
+    Synchronous messages between processes, addressed by pid. send blocks
+    until the receiver takes the message, recv blocks until one arrives,
+    call sends and then waits for the answer from the same process, which
+    the server gives with a plain send. The fixed words always travel, a
+    buffer of up to IPC_BUF_MAX bytes only when len is set. For recv, buf
+    and len say where incoming data goes, len comes back as what was
+    copied. Shared with ../syscalls, the includer provides the stdint types.
+*/
+
+#define IPC_WORDS   4
+#define IPC_BUF_MAX 512
+// recv from whoever sends first
+#define IPC_ANY     (-1)
+
+typedef struct ipc_msg{
+    uint32_t words[IPC_WORDS];
+    uint32_t buf;
+    uint32_t len;
+} ipc_msg_t;
+
+#endif /* _IPC_DATA_H */
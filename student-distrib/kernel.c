@@ -15,6 +15,9 @@
 #include "terminal.h"
 #include "system_calls.h"
 #include "sched.h"
+#include "smp.h"
+#include "system_calls_asm.h"
+#include "vdso.h"
 
 //#define RUN_TESTS
 #define IRQ_SIZE 16
@@ -144,14 +147,22 @@ void entry(unsigned long magic, unsigned long addr) {
         ltr(KERNEL_TSS);
     }
 
+    /* Fast system call entry, int 0x80 stays in the IDT */
+    sysenter_init(&tss);
+
     /* Init the PIC, devices, paging, and file system */
 
     i8259_init();
     keyboard_init();
     rtc_init();
+    smp_detect();
     init_paging();
     fs_init();
     PIT_init();
+    vdso_init();
+    vidbuf_init();
+    fb_init();
+    smp_init();
 
     /* Enable interrupts */
     /* Do not enable the following until after you have set up your
@@ -3,17 +3,22 @@
  */
 
 #include "keyboard.h"
+#include "sched.h"
+#include "softirq.h"
 
 #define TAKETHATL 0x26
-
-static uint8_t key_buffer[NUM_OF_TERMINALS][BUFFER_SIZE];
-static int buffer_index[NUM_OF_TERMINALS] = {0,0,0};
+#define SC_C 0x2E
 
 uint8_t get_char(uint8_t s_code);
+static void keyboard_softirq();
+static void keyboard_process(uint8_t input);
 int key_code_flags[KEY_CODE_FLAG_AMOUNT];
 
-//pre declaration
-void clear_buffer();
+//scancodes from the interrupt waiting for keyboard_softirq, the interrupt only
+//moves the tail and the softirq only moves the head
+static volatile uint8_t scancode_ring[SCANCODE_RING_SIZE];
+static volatile uint32_t scancode_head = 0;
+static volatile uint32_t scancode_tail = 0;
 
 //flags for special inputs
 volatile uint8_t shift_l = 0;
@@ -62,124 +67,156 @@ uint8_t s_code_table_why[58] = {0,0,'!', '@', '#', '$', '%', '^', '&', '*', '(',
  */
 
 void keyboard_init(void){
-  int i;
   cur_term = 0;
-  for(i = 0; i< NUM_OF_TERMINALS; i++){
-    hit_enter_key[i] = 0;
-  }
+  open_softirq(SOFTIRQ_KEYBOARD, keyboard_softirq);
   enable_irq(IRQ_KEYBOARD);
 }
 
 
 /*
  * keyboard_interrupt_handler()
- * DESCRIPTION: handles keyboard generated interrupt
+ * DESCRIPTION: top half of the keyboard interrupt, only queues the scancode
+ *              for keyboard_softirq so interrupts are off as briefly as possible
  * INPUT: none
  * OUTPUT: none
  * RETURNS: none
- * SIDE EFFECTS: reads from keyboard por
- *               prints charecters to screen
+ * SIDE EFFECTS: reads from keyboard port, raises SOFTIRQ_KEYBOARD
  *               sends EOI for keyboard so another interrupt can be sent
  */
 void keyboard_interrupt_handler(){
-    uint8_t output = 0;
     uint8_t input = 0;
 
     //grab input from keyboard port, keep pulling till valid output is given
     while(input == 0){
         input = inb(PS2_PORT);
     }
+    //a full ring drops the key, the bottom half is far behind
+    if(scancode_tail - scancode_head < SCANCODE_RING_SIZE){
+        scancode_ring[scancode_tail & (SCANCODE_RING_SIZE - 1)] = input;
+        scancode_tail++;
+    }
+    raise_softirq(SOFTIRQ_KEYBOARD);
+    send_eoi(IRQ_KEYBOARD);
+}
+
+/*
+ * keyboard_softirq()
+ * DESCRIPTION: bottom half of the keyboard interrupt, runs with interrupts enabled
+ *              except while it takes a scancode off the ring
+ * INPUT: none
+ * OUTPUT: none
+ * RETURNS: none
+ * SIDE EFFECTS: handles every queued scancode
+ */
+static void keyboard_softirq(){
+    uint8_t input;
+    uint32_t flags;
+
+    while(1){
+        // tasks switched out of a softirq run their own, so several tasks can be
+        // in here at once: take each scancode with interrupts off so only one gets it
+        cli_and_save(flags);
+        if(scancode_head == scancode_tail){
+            restore_flags(flags);
+            break;
+        }
+        input = scancode_ring[scancode_head & (SCANCODE_RING_SIZE - 1)];
+        scancode_head++;
+        restore_flags(flags);
+        keyboard_process(input);
+        // sched may come back with interrupts off
+        sti();
+    }
+}
+
+/*
+ * keyboard_process(uint8_t input)
+ * DESCRIPTION: decodes one scancode, tracks modifiers, feeds the line discipline
+ *              and switches terminals
+ * INPUT: input - scancode
+ * OUTPUT: none
+ * RETURNS: none
+ * SIDE EFFECTS: prints charecters to screen
+ */
+static void keyboard_process(uint8_t input){
+    uint8_t output = 0;
+    uint32_t flags;
+
     switch(input) {
       case SC_SHIFT_LEFT: //pressed shift key
         shift_l = 1;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_SHIFT_LEFT_REL: //released shift key
         shift_l = 0;
-        send_eoi(IRQ_KEYBOARD);
         return;
   	  case SC_SHIFT_RIGHT:
         shift_r = 1;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_SHIFT_RIGHT_REL:
         shift_r = 0;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_CAPS: //pressed caps lock
         caps = !caps;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_CAPS_REL: // released caps key
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_CTRL: //pressed control key
         ctrl = 1;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_CTRL_REL: //released control key
         ctrl = 0;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_ALT_LEFT:
         alt_l = 1;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_ALT_LEFT_REL:
         alt_l = 0;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_ALT_RIGHT:
         alt_r = 1;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_ALT_RIGHT_REL:
         alt_r = 0;
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_ENTER: //pressed enter key
-        putc(s_code_table[28]);
-        if(buffer_index[cur_term] < BUFFER_SIZE) {
-          key_buffer[cur_term][buffer_index[cur_term]] = '\n';
-          buffer_index[cur_term]++;
-        }
-        /* Pass buffer */
-        copy_to_terminal_buffer((char*)key_buffer[cur_term], buffer_index[cur_term]);
-        hit_enter_key[cur_term] = 1;
-
-        clear_buffer(cur_term);
-        send_eoi(IRQ_KEYBOARD);
+        /* Finish the line and wake the terminal's readers */
+        terminal_input(cur_term, s_code_table[SC_ENTER]);
+        // run the woken reader now instead of waiting for the next PIT tick
+        sched();
         return;
       case SC_ENTER_REL: //released enter key
-        send_eoi(IRQ_KEYBOARD);
         return;
       case SC_BACKSPACE: //pressed enter key
-        if(buffer_index[cur_term] > 0){
-          buffer_index[cur_term]--;
-          key_buffer[cur_term][buffer_index[cur_term]] = ' ';
-          output = get_char(input);
-          putc(output);
-        }
-        send_eoi(IRQ_KEYBOARD);
+        terminal_input(cur_term, get_char(input));
         return;
       case SC_BACKSPACE_REL: //released enter key
-        send_eoi(IRQ_KEYBOARD);
         return;
       default:     
         //ctrl + L should clear screen
         if(ctrl == 1 && input == TAKETHATL && (shift_r||shift_l) != 1) {
+          flags = spin_lock_irqsave(&term_lock);
           clear();
+          spin_unlock_irqrestore(&term_lock, flags);
           reset_cursor(); //reset cursor to (0,0) since we cleared screen
-          clear_buffer(cur_term);
-          send_eoi(IRQ_KEYBOARD);
+          terminal_discard_line(cur_term);
+          return;
+        }
+        //shift + PgUp/PgDn pages through the history of the terminal on screen
+        if((shift_l || shift_r) && (input == SC_PGUP || input == SC_PGDN)) {
+          scrollback_page((input == SC_PGUP) ? -1 : 1);
+          return;
+        }
+        //ctrl + C interrupts the program in the foreground
+        if(ctrl == 1 && input == SC_C) {
+          signal_interrupt_term(cur_term);
           return;
         }
         // check to see if key pressed is printable
-        if(input <= SC_SPACE && ctrl != 1 && buffer_index[cur_term]<BUFFER_SIZE-1){
+        if(input <= SC_SPACE && ctrl != 1){
           output = get_char(input);
-          key_buffer[cur_term][buffer_index[cur_term]] = output;
-          buffer_index[cur_term]++;
-          putc(output);
+          if(output != 0){
+            terminal_input(cur_term, output);
+          }
         }
         
         break;
@@ -187,7 +224,6 @@ void keyboard_interrupt_handler(){
     
     
     if(alt_l || alt_r){
-      send_eoi(IRQ_KEYBOARD);
       switch (input)
       {
       case SC_F1:
@@ -207,8 +243,6 @@ void keyboard_interrupt_handler(){
         break;
       }
     }
-    // send end of interrupt signal
-    send_eoi(IRQ_KEYBOARD);
 }
 
 /*
@@ -232,19 +266,3 @@ uint8_t get_char(uint8_t s_code){
   else //both active
     return s_code_table_why[s_code];
 }
-
-/*
- * clear_buffer(int term_num)
- * DESCRIPTION: clears appropriate keyboard buffer
- * INPUT: terminal number
- * OUTPUT: none
- * RETURNS: none
- * SIDE EFFECTS: buffer is cleared and index is reset
- */
-void clear_buffer(int term_num){
-  int i;
-  for(i = 0; i < BUFFER_SIZE; i++){
-    key_buffer[term_num][i] = ' ';
-  }
-  buffer_index[cur_term] = 0;
-}
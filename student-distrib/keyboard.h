@@ -18,9 +18,9 @@
 /*number of key code flags*/
 #define KEY_CODE_FLAG_AMOUNT    (0x7D)
 
-/*buffer constants*/
-#define BUFFER_SIZE          128
 #define NUM_OF_TERMINALS       3
+/*scancodes queued for the bottom half, a power of two*/
+#define SCANCODE_RING_SIZE    64
 
 /* Opcodes for keyboard */
 
@@ -61,11 +61,10 @@
 #define SC_F1               0x3B
 #define SC_F2               0x3C
 #define SC_F3               0x3D
+#define SC_PGUP             0x49
+#define SC_PGDN             0x51
 
 
-/* Used for inputs */
-volatile uint8_t hit_enter_key[3];
-
 /* Externally-visible functions */
 
 /* Initialize keyboard */
@@ -2,6 +2,7 @@
  * vim:ts=4 noexpandtab */
 
 #include "lib.h"
+#include "vdso.h"
 
 #define VIDEO       0xB8000
 #define NUM_COLS    80
@@ -13,12 +14,267 @@
 #define ORIG_ATTRIB 0x7
 #define BSOD_ATTRIB 0x1F
 #define BACKSPACE   0x08
+#define ESC         0x1B
+
+//escape sequence parser states
+#define ESC_NONE    0
+#define ESC_START   1
+#define ESC_CSI     2
+#define ESC_MAX_PARAMS 8
+#define ESC_MAX_VALUE  9999
+
+#define TERM_ROWS   (VID_RING_SIZE / (NUM_COLS * 2))
+//lines of history kept per terminal, a power of two so line numbers can run free
+#define SCROLLBACK_LINES 4096
+//most bytes term_write handles with term_lock held
+#define TERM_CHUNK  256
 
 static int screen_x[NUM_OF_TERMINALS] = {0, 0, 0};
 static int screen_y[NUM_OF_TERMINALS] = {0, 0, 0};
+//row of the terminal's text memory the screen starts at, scrolling moves it
+static int screen_top[NUM_OF_TERMINALS] = {0, 0, 0};
+//processes with the terminal's screen mapped through vidmap, which needs it at row 0
+static int screen_pins[NUM_OF_TERMINALS] = {0, 0, 0};
+//rows that scrolled off the top of each terminal, as char/attribute cells
+static uint16_t scrollback[NUM_OF_TERMINALS][SCROLLBACK_LINES][NUM_COLS];
+//number of rows ever pushed, row n is kept in scrollback line n % SCROLLBACK_LINES
+static uint32_t scrollback_lines[NUM_OF_TERMINALS] = {0, 0, 0};
+//set while the terminal on screen shows history, view_top is the history row at the top
+static int view_on = 0;
+static uint32_t view_top = 0;
+
+//display start and cursor position the CRTC holds, 0xFFFF until first set
+static uint16_t hw_start = 0xFFFF;
+static uint16_t hw_cursor = 0xFFFF;
+uint32_t vga_port_writes = 0;
+
+//escape sequence and attribute state of a terminal's output
+typedef struct term_esc {
+    int32_t state;
+    int32_t priv;                       //'?' sequences are parsed and ignored
+    int32_t nparams;
+    int32_t params[ESC_MAX_PARAMS];
+    uint8_t attr;                       //attribute text is drawn with
+    uint8_t fg, bg, bold, reverse;
+    int32_t top, bottom;                //scroll region, rows inclusive
+    int32_t saved_x, saved_y;
+} term_esc_t;
+
+#define TERM_ESC_INIT(attrib) \
+    {ESC_NONE, 0, 0, {0}, (attrib), (attrib) & 0x0F, (attrib) >> 4, 0, 0, 0, NUM_ROWS - 1, 0, 0}
+
+static term_esc_t term_esc[NUM_OF_TERMINALS] = {
+    TERM_ESC_INIT(ATTRIB_G), TERM_ESC_INIT(ATTRIB_Y), TERM_ESC_INIT(ATTRIB_W)
+};
+//attribute each terminal starts with
+static const uint8_t term_attrib[NUM_OF_TERMINALS] = {ATTRIB_G, ATTRIB_Y, ATTRIB_W};
+//ANSI color numbers in VGA order
+static const uint8_t ansi_colors[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+static int32_t term_write(int32_t visible, const uint8_t* buf, int32_t n);
+static int32_t put_str(int8_t* s);
+
+
+/* void crtc_write(uint8_t high_reg, uint16_t value, uint16_t* cached);
+ * Inputs: high_reg = CRTC index of the high byte, the low byte is the next register
+ *         value = value for the register pair
+ *         cached = what the pair was last set to, 0xFFFF before the first write
+ * Return Value: none
+ * Function: Writes the bytes of a CRTC register pair that changed. Port writes
+ *           are slow, more so under virtualization, and are counted in vga_port_writes */
+static void crtc_write(uint8_t high_reg, uint16_t value, uint16_t* cached) {
+    if(*cached == 0xFFFF || ((*cached ^ value) & 0xFF00)) {
+        outb(high_reg, 0x3D4);
+        outb((uint8_t)((value >> 8) & 0xFF), 0x3D5);
+        vga_port_writes += 2;
+    }
+    if(*cached == 0xFFFF || ((*cached ^ value) & 0x00FF)) {
+        outb(high_reg + 1, 0x3D4);
+        outb((uint8_t)(value & 0xFF), 0x3D5);
+        vga_port_writes += 2;
+    }
+    if(*cached != value) vdso_set_vga_port_writes(vga_port_writes);
+    *cached = value;
+}
+
+/* void set_display_start(uint16_t pos);
+ * Inputs: pos = character offset in text memory of the top left corner
+ * Return Value: none
+ * Function: Points the VGA CRTC start address registers at pos */
+static void set_display_start(uint16_t pos) {
+    crtc_write(0x0C, pos, &hw_start);
+}
+
+/* uint16_t term_start(int32_t term);
+ * Inputs: term = terminal number
+ * Return Value: character offset in text memory of the terminal's screen
+ * Function: Gives the display start address that shows a terminal */
+static uint16_t term_start(int32_t term) {
+    return (TERM_VID_ADDR(term) - VIDEO) / 2 + screen_top[term] * NUM_COLS;
+}
+
+/* uint16_t* term_screen(int32_t term);
+ * Inputs: term = terminal number
+ * Return Value: first cell of the terminal's screen
+ * Function: Finds where a terminal's screen is, caller holds term_lock */
+static uint16_t* term_screen(int32_t term) {
+    return (uint16_t*)TERM_VID_ADDR(term) + screen_top[term] * NUM_COLS;
+}
+
+/* void scrollback_push(int32_t term, const uint16_t* src, int32_t rows, uint16_t blank);
+ * Inputs: term = terminal number
+ *         src = first of the rows to keep, NULL for blank rows
+ *         rows = number of rows
+ *         blank = cell blank rows are filled with
+ * Return Value: none
+ * Function: Adds rows to the end of a terminal's history, caller holds term_lock.
+ *           Each row overwrites the oldest one, so nothing else is moved */
+static void scrollback_push(int32_t term, const uint16_t* src, int32_t rows, uint16_t blank) {
+    int32_t i;
+    uint16_t* line;
+
+    //rows that would be overwritten by the same push are only counted
+    if(rows > SCROLLBACK_LINES) {
+        scrollback_lines[term] += rows - SCROLLBACK_LINES;
+        if(src != NULL)
+            src += (rows - SCROLLBACK_LINES) * NUM_COLS;
+        rows = SCROLLBACK_LINES;
+    }
+    for(i = 0; i < rows; i++) {
+        line = scrollback[term][scrollback_lines[term]++ & (SCROLLBACK_LINES - 1)];
+        if(src != NULL)
+            memcpy(line, src + i * NUM_COLS, NUM_COLS * 2);
+        else
+            memset_word(line, blank, NUM_COLS);
+    }
+}
+
+/* void term_scroll(int32_t term, int32_t rows, uint16_t blank);
+ * Inputs: term = terminal number
+ *         rows = number of rows to scroll up
+ *         blank = cell to fill the rows coming in with
+ * Return Value: none
+ * Function: Scrolls a terminal, caller holds term_lock. The screen just moves
+ *           down the terminal's text memory, the rows that stay are only copied
+ *           once it runs off the end. A terminal pinned by vidmap moves its rows
+ *           up by hand. The rows leaving the top go to the terminal's history.
+ *           The display start follows the terminal on screen */
+static void term_scroll(int32_t term, int32_t rows, uint16_t blank) {
+    uint16_t* screen = term_screen(term);
+    uint16_t* dest = screen;
+
+    if(rows > NUM_ROWS) rows = NUM_ROWS;
+    scrollback_push(term, screen, rows, blank);
+
+    if(screen_pins[term] == 0) {
+        if(screen_top[term] + rows + NUM_ROWS <= TERM_ROWS) {
+            //the rows that stay are already in place
+            screen_top[term] += rows;
+            dest = screen + rows * NUM_COLS;
+        } else {
+            screen_top[term] = 0;
+            dest = (uint16_t*)TERM_VID_ADDR(term);
+        }
+        if(term == cur_term && !view_on) {
+            set_display_start(term_start(term));
+        }
+    }
+
+    if(dest != screen + rows * NUM_COLS && rows < NUM_ROWS) {
+        memmove(dest, screen + rows * NUM_COLS, (NUM_ROWS - rows) * NUM_COLS * 2);
+    }
+    memset_word(dest + (NUM_ROWS - rows) * NUM_COLS, blank, rows * NUM_COLS);
+}
+
+/* void switch_screen(int32_t term);
+ * Inputs: term = terminal to show, already cur_term
+ * Return Value: none
+ * Function: Points the display at the terminal's screen, caller holds term_lock.
+ *           Nothing is copied, every terminal stays in its own text memory.
+ *           A terminal that was showing its history goes back to its screen */
+void switch_screen(int32_t term) {
+    view_on = 0;
+    set_display_start(term_start(term));
+}
+
+/* void scrollback_page(int32_t dir);
+ * Inputs: dir = -1 to page back through the history, 1 to page forward
+ * Return Value: none
+ * Function: Pages the terminal on screen through its history. The window is
+ *           copied into the spare text memory at VIEW_VID_ADDR and shown from
+ *           there, so output keeps going to the terminal's screen underneath.
+ *           Paging forward past the last history row shows the screen again */
+void scrollback_page(int32_t dir) {
+    uint32_t flags = spin_lock_irqsave(&term_lock);
+    int32_t term = cur_term;
+    int32_t i;
+    uint32_t total = scrollback_lines[term];
+    uint32_t oldest = (total > SCROLLBACK_LINES) ? total - SCROLLBACK_LINES : 0;
+    uint32_t top = view_on ? view_top : total;
+    uint32_t line;
+    uint16_t* view = (uint16_t*)VIEW_VID_ADDR;
+
+    //rows being looked at may have been overwritten by output since
+    if(top < oldest) top = oldest;
+    if(dir < 0)
+        top = (top - oldest > NUM_ROWS - 1) ? top - (NUM_ROWS - 1) : oldest;
+    else
+        top += NUM_ROWS - 1;
+
+    if(top >= total) {
+        view_on = 0;
+        set_display_start(term_start(term));
+    } else {
+        view_on = 1;
+        view_top = top;
+        //the bottom of the window can run into the screen itself
+        for(i = 0; i < NUM_ROWS; i++) {
+            line = top + i;
+            if(line < total)
+                memcpy(view + i * NUM_COLS, scrollback[term][line & (SCROLLBACK_LINES - 1)], NUM_COLS * 2);
+            else
+                memcpy(view + i * NUM_COLS, term_screen(term) + (line - total) * NUM_COLS, NUM_COLS * 2);
+        }
+        set_display_start((VIEW_VID_ADDR - VIDEO) / 2);
+    }
+    spin_unlock_irqrestore(&term_lock, flags);
+    update_cursor();
+}
 
+/* void scrollback_reset(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Puts the terminal on screen back on its screen if it shows history */
+void scrollback_reset(void) {
+    uint32_t flags = spin_lock_irqsave(&term_lock);
+    if(view_on) {
+        view_on = 0;
+        set_display_start(term_start(cur_term));
+    }
+    spin_unlock_irqrestore(&term_lock, flags);
+    update_cursor();
+}
 
-static char* video_mem = (char *)VIDEO;
+/* void screen_pin(int32_t term, int32_t pin);
+ * Inputs: term = terminal number
+ *         pin = 1 when a process maps the screen through vidmap, 0 when it unmaps it
+ * Return Value: none
+ * Function: vidmap hands out the page at the start of the terminal's text memory,
+ *           so while it is mapped the screen is kept at row 0 and scrolls by copying */
+void screen_pin(int32_t term, int32_t pin) {
+    uint32_t flags = spin_lock_irqsave(&term_lock);
+    if(!pin) {
+        screen_pins[term]--;
+    } else if(screen_pins[term]++ == 0 && screen_top[term] != 0) {
+        memmove((uint16_t*)TERM_VID_ADDR(term), term_screen(term), NUM_ROWS * NUM_COLS * 2);
+        screen_top[term] = 0;
+        if(term == cur_term && !view_on) {
+            set_display_start(term_start(term));
+        }
+    }
+    spin_unlock_irqrestore(&term_lock, flags);
+    update_cursor();
+}
 
 /* void clear(void);
  * Inputs: void
@@ -26,7 +282,11 @@ static char* video_mem = (char *)VIDEO;
  * Function: Clears video memory */
 void clear(void) {
     int32_t i;
-    uint8_t color = (cur_term == 0) ? ATTRIB_G : (cur_term == 1) ? ATTRIB_Y : ATTRIB_W;
+    uint8_t color = term_esc[cur_term].attr;
+    char* video_mem = (char *)TERM_VID_ADDR(cur_term);
+    screen_top[cur_term] = 0;
+    view_on = 0;
+    set_display_start(term_start(cur_term));
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
         *(uint8_t *)(video_mem + (i << 1)) = ' ';
         *(uint8_t *)(video_mem + (i << 1) + 1) = color;
@@ -48,8 +308,15 @@ void BSOD(char* str) {
     }
 
     cli();
+    // the screen is ours now, drop the terminal lock in case we crashed holding it
+    term_lock.owner = NO_OWNER;
+    term_lock.locked = 0;
     int32_t i;
-    /* Clear screen */
+    char* video_mem = (char *)TERM_VID_ADDR(cur_term);
+    /* Clear screen, putting it back at the start of the terminal's text memory */
+    screen_top[cur_term] = 0;
+    view_on = 0;
+    set_display_start(term_start(cur_term));
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
         *(uint8_t *)(video_mem + (i << 1)) = ' ';
     }
@@ -78,44 +345,32 @@ void reset_cursor(void) {
     else {
         term = 0;
     }
-    if(cur_pid != -1)
-        cli();
+    uint32_t flags = spin_lock_irqsave(&term_lock);
     screen_x[term] = 0;
     screen_y[term] = 0;
-    uint16_t pos = screen_y[term] * NUM_COLS + screen_x[term];
-    outb(0x0F, 0x3D4);
-    outb((uint8_t)(pos & 0xFF), 0x3D5);
-    outb(0x0E, 0x3D4);
-    outb((uint8_t)((pos >>8) & 0xFF), 0x3D5);
-    if(cur_pid != -1){
-        sti();
-    }
+    uint16_t pos = term_start(term) + screen_y[term] * NUM_COLS + screen_x[term];
+    crtc_write(0x0E, pos, &hw_cursor);
+    spin_unlock_irqrestore(&term_lock, flags);
     return;
 }
 /* update_cursor
 * Inputs: none
 * Return value: none
-* Side effects: updates cursor position
+* Side effects: moves the hardware cursor to the cursor of the terminal on screen.
+*   Writing to a terminal only moves its cursor in memory, this is called at the
+*   end of a write call, after echoing input, before a read blocks and when the
+*   terminal on screen changes. Nothing is written if the cursor did not move
 * source: wiki.osdev.org/Text_Mode_Cursor
 */
 void update_cursor(void) {
-    int term;
-    if(cur_pid != -1){
-        term = pcb_ptr_array[cur_pid]->term_id;
-    }
-    else {
-        term = 0;
-    }
-    term = cur_term;
-    if(cur_pid != -1)
-        cli();
-    uint16_t pos = screen_y[term] * NUM_COLS + screen_x[term];
-    outb(0x0F, 0x3D4);
-    outb((uint8_t)(pos & 0xFF), 0x3D5);
-    outb(0x0E, 0x3D4);
-    outb((uint8_t)((pos >>8) & 0xFF), 0x3D5);
-    if(cur_pid != -1)
-        sti();
+    int term = cur_term;
+    uint32_t flags = spin_lock_irqsave(&term_lock);
+    uint16_t pos = term_start(term) + screen_y[term] * NUM_COLS + screen_x[term];
+    //hide the cursor below the window while history is shown
+    if(view_on)
+        pos = (VIEW_VID_ADDR - VIDEO) / 2 + NUM_ROWS * NUM_COLS;
+    crtc_write(0x0E, pos, &hw_cursor);
+    spin_unlock_irqrestore(&term_lock, flags);
 }
 
 
@@ -175,7 +430,7 @@ format_char_switch:
                                 int8_t conv_buf[64];
                                 if (alternate == 0) {
                                     itoa(*((uint32_t *)esp), conv_buf, 16);
-                                    puts(conv_buf);
+                                    put_str(conv_buf);
                                 } else {
                                     int32_t starting_index;
                                     int32_t i;
@@ -185,7 +440,7 @@ format_char_switch:
                                         conv_buf[i] = '0';
                                         i++;
                                     }
-                                    puts(&conv_buf[starting_index]);
+                                    put_str(&conv_buf[starting_index]);
                                 }
                                 esp++;
                             }
@@ -196,7 +451,7 @@ format_char_switch:
                             {
                                 int8_t conv_buf[36];
                                 itoa(*((uint32_t *)esp), conv_buf, 10);
-                                puts(conv_buf);
+                                put_str(conv_buf);
                                 esp++;
                             }
                             break;
@@ -212,7 +467,7 @@ format_char_switch:
                                 } else {
                                     itoa(value, conv_buf, 10);
                                 }
-                                puts(conv_buf);
+                                put_str(conv_buf);
                                 esp++;
                             }
                             break;
@@ -225,7 +480,7 @@ format_char_switch:
 
                         /* Print a NULL-terminated string */
                         case 's':
-                            puts(*((int8_t **)esp));
+                            put_str(*((int8_t **)esp));
                             esp++;
                             break;
 
@@ -242,6 +497,7 @@ format_char_switch:
         }
         buf++;
     }
+    update_cursor();
     return (buf - format);
 }
 
@@ -250,201 +506,439 @@ format_char_switch:
  *   Return Value: Number of bytes written
  *    Function: Output a string to the console */
 int32_t puts(int8_t* s) {
-    register int32_t index = 0;
-    while (s[index] != '\0') {
-        putc(s[index]);
-        index++;
-    }
+    register int32_t index = put_str(s);
+    update_cursor();
     return index;
 }
 
-/* void putc(uint8_t c);
- * Inputs: uint_8* c = character to print
- * Return Value: void
- *  Function: Output a character to the console */
-void putc(uint8_t c) {
-
-    if(cur_pid != -1)
-        cli();
-
-    int term;
+/* int32_t put_str(int8_t* s);
+ *   Inputs: int_8* s = pointer to a string of characters
+ *   Return Value: Number of bytes written
+ *    Function: puts without the cursor update, printf moves it once at the end */
+static int32_t put_str(int8_t* s) {
+    register int32_t index = strlen(s);
+    term_write(1, (const uint8_t*)s, index);
+    return index;
+}
 
-    uint8_t color = (cur_term == 0) ? ATTRIB_G : (cur_term == 1) ? ATTRIB_Y : ATTRIB_W;
-
-    term = cur_term;
-
-    char* term_mem = video_mem;
-
-    if(cur_pid > -1 && cur_pid < MAX_PCBS){
-        if(pcb_ptr_array[cur_pid] != NULL){
-            if(cur_term != term){
-                switch(pcb_ptr_array[cur_pid]->term_id) {
-                    case 0:
-                        term_mem = (char *)TERM1_ADDR;
-                        break;
-                    case 1:
-                        term_mem = (char *)TERM2_ADDR;
-                        break;
-                    case 2:
-                        term_mem = (char *)TERM3_ADDR;
-                        break;
-                }
-            }
+/* int32_t term_step(uint8_t c, int32_t* x, int32_t* y, int32_t* cell);
+ * Inputs: c = character being printed
+ *         x, y = cursor position, moved past c
+ *         cell = set to the screen cell c writes, -1 if it writes none
+ * Return Value: 1 if the screen scrolls after c, 0 otherwise
+ *  Function: Moves the cursor for one character the same way putc does,
+ *            without touching video memory */
+static int32_t term_step(uint8_t c, int32_t* x, int32_t* y, int32_t* cell) {
+    if(c == BACKSPACE) {
+        if(*x > 0) {
+            (*x)--;
+        }
+        else if(*y > 0) {
+            *x = NUM_COLS - 1;
+            (*y)--;
         }
+        *cell = NUM_COLS * (*y) + (*x);
+        return 0;
     }
+    if(c == '\n' || c == '\r') {
+        *cell = -1;
+        *x = 0;
+        (*y)++;
+    } else {
+        *cell = NUM_COLS * (*y) + (*x);
+        if(++(*x) == NUM_COLS) {
+            *x = 0;
+            (*y)++;
+        }
+    }
+    if(*y >= NUM_ROWS) {
+        *x = 0;
+        *y = NUM_ROWS - 1;
+        return 1;
+    }
+    return 0;
+}
 
-  if(c == BACKSPACE) { //added functionality for backspace
-    if(screen_x[term] > 0) { //move cursor 1 space back
-      screen_x[term] = screen_x[term] - 1;
+/* void term_text(int32_t term, const uint8_t* buf, int32_t n);
+ * Inputs: term = terminal number
+ *         buf = characters to print, no escapes
+ *         n = number of characters
+ * Return Value: none
+ *  Function: Prints plain text with the whole screen as the scroll region, caller
+ *            holds term_lock. A first pass only moves the cursor to count how far
+ *            the screen scrolls, then the screen is scrolled once and every
+ *            character is stored as a char/attribute word straight into the row it
+ *            ends up on. Characters that would scroll off are stored in the history
+ *            instead of video memory, so output longer than the screen is only
+ *            drawn from its last screenful */
+static void term_text(int32_t term, const uint8_t* buf, int32_t n) {
+    int32_t i, x, y, cell, row;
+    int32_t scrolls = 0;
+    uint16_t* term_mem;
+    uint16_t (*history)[NUM_COLS];
+    uint32_t total;
+    uint16_t attr, out;
+
+    attr = term_esc[term].attr << 8;
+
+    //count the scrolls
+    x = screen_x[term];
+    y = screen_y[term];
+    for(i = 0; i < n; i++) {
+        scrolls += term_step(buf[i], &x, &y, &cell);
     }
-    else if(screen_x[term] == 0 && screen_y[term] > 0) { //sanity check for beginning of lines
-      screen_x[term] = NUM_COLS - 1;
-      screen_y[term] = screen_y[term] - 1;
+
+    //scroll what is already on screen once, blanking the rows that come in.
+    //Rows that scroll past it start out blank in the history
+    if(scrolls > 0)
+        term_scroll(term, scrolls, attr | ' ');
+    if(scrolls > NUM_ROWS)
+        scrollback_push(term, NULL, scrolls - NUM_ROWS, attr | ' ');
+    term_mem = term_screen(term);
+    history = scrollback[term];
+    total = scrollback_lines[term];
+
+    //draw each character on the row it is on after the remaining scrolls,
+    //rows above the screen are the last rows of the history
+    x = screen_x[term];
+    y = screen_y[term];
+    for(i = 0; i < n; i++) {
+        uint8_t c = buf[i];
+        int32_t scrolled = term_step(c, &x, &y, &cell);
+        if(cell >= 0) {
+            row = cell / NUM_COLS - scrolls;
+            out = attr | ((c == BACKSPACE) ? ' ' : c);
+            if(row >= 0)
+                term_mem[row * NUM_COLS + cell % NUM_COLS] = out;
+            else if(-row <= SCROLLBACK_LINES)
+                history[(total + row) & (SCROLLBACK_LINES - 1)][cell % NUM_COLS] = out;
+        }
+        scrolls -= scrolled;
     }
-    *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1)) = ' '; //fill with empty character for illusion of backspace
-    *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1) + 1) = color;
 
-    if(cur_pid != -1)
-        sti();
-    
-    update_cursor(); //update cursor here and return to avoid unnecessary conflicts
+    screen_x[term] = x;
+    screen_y[term] = y;
+}
 
-    return;
-  }
+/* void region_scroll(int32_t term);
+ * Inputs: term = terminal number
+ * Return Value: none
+ *  Function: Scrolls the terminal's scroll region up a row, caller holds term_lock.
+ *            Rows outside the region stay and nothing goes to the history */
+static void region_scroll(int32_t term) {
+    term_esc_t* esc = &term_esc[term];
+    uint16_t* term_mem = term_screen(term);
+
+    memmove(term_mem + esc->top * NUM_COLS, term_mem + (esc->top + 1) * NUM_COLS,
+            (esc->bottom - esc->top) * NUM_COLS * 2);
+    memset_word(term_mem + esc->bottom * NUM_COLS, (esc->attr << 8) | ' ', NUM_COLS);
+}
 
-                                 //test here to fix bug where line was being overwritten. Move to next line to avoid error
-    if(c == '\n' || c == '\r' /*((screen_x[term] == NUM_COLS) && screen_y[term] != NUM_ROWS - 1)*/) {
-        screen_y[term]++;
-        screen_x[term] = 0;
-    } else {
-        *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1)) = c;
-        *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1) + 1) = color;
-        screen_x[term]++;
-        //screen_x[term] %= NUM_COLS;
-        screen_y[term] = (screen_y[term] + (screen_x[term] / NUM_COLS));
-    }
-
-    if(((screen_x[term] == NUM_COLS) && screen_y[term] != NUM_ROWS)) {
-      screen_x[term] = 0;
-    }
-
-    if( screen_y[term] >= NUM_ROWS) {
-      int32_t i;                                      //clear first row and
-      for (i = 0; i < (NUM_ROWS - 1) * NUM_COLS; i++) //move each row below the first up one.
-      {   //shifts everything up one line
-          *(uint8_t *)(term_mem + (i << 1)) = *(uint8_t *)(term_mem + ((NUM_COLS + i) << 1));
-          *(uint8_t *)(term_mem + (i << 1) + 1) = *(uint8_t *)(term_mem + ((NUM_COLS + i) << 1) + 1);
-      }
-      for(i = (NUM_ROWS - 1) * NUM_COLS; i < NUM_ROWS * NUM_COLS; i++) //clear last row
-      {
-          *(uint8_t *)(term_mem + (i << 1)) = ' ';
-          *(uint8_t *)(term_mem + (i << 1) + 1) = color;
-      }
-      //reset screen values and update cursor to give illusion of scrolling
-      screen_x[term] = 0;
-      screen_y[term] = NUM_ROWS - 1;
-    }
-
-    if(cur_pid != -1)
-        sti();
-    
-    update_cursor(); //just universally do this for all calls
-    return;
+/* void term_text_region(int32_t term, const uint8_t* buf, int32_t n);
+ * Inputs: term = terminal number
+ *         buf = characters to print, no escapes
+ *         n = number of characters
+ * Return Value: none
+ *  Function: Prints plain text a character at a time while a scroll region is set,
+ *            caller holds term_lock. A new line on the bottom row of the region
+ *            scrolls the region, below it the cursor stops at the last row */
+static void term_text_region(int32_t term, const uint8_t* buf, int32_t n) {
+    term_esc_t* esc = &term_esc[term];
+    uint16_t* term_mem = term_screen(term);
+    int32_t i, x = screen_x[term], y = screen_y[term];
+    int32_t newline;
+
+    for(i = 0; i < n; i++) {
+        uint8_t c = buf[i];
+        newline = 0;
+        if(c == BACKSPACE) {
+            if(x > 0) {
+                x--;
+            } else if(y > 0) {
+                x = NUM_COLS - 1;
+                y--;
+            }
+            term_mem[y * NUM_COLS + x] = (esc->attr << 8) | ' ';
+        } else if(c == '\n' || c == '\r') {
+            x = 0;
+            newline = 1;
+        } else {
+            term_mem[y * NUM_COLS + x] = (esc->attr << 8) | c;
+            if(++x == NUM_COLS) {
+                x = 0;
+                newline = 1;
+            }
+        }
+        if(newline) {
+            if(y == esc->bottom)
+                region_scroll(term);
+            else if(y < NUM_ROWS - 1)
+                y++;
+        }
+    }
+
+    screen_x[term] = x;
+    screen_y[term] = y;
 }
 
-/* void putc_syscall(uint8_t c);
- * Inputs: uint_8* c = character to print
- * Return Value: void
- *  Function: Output a character to the console */
-void putc_syscall(uint8_t c) {
+/* void term_sgr(term_esc_t* esc, int32_t code, uint8_t attrib);
+ * Inputs: esc = output state of the terminal
+ *         code = SGR parameter
+ *         attrib = the terminal's default attribute
+ * Return Value: none
+ *  Function: Applies one select graphic rendition parameter and works out the
+ *            attribute text is drawn with. Bold is the VGA bright foreground */
+static void term_sgr(term_esc_t* esc, int32_t code, uint8_t attrib) {
+    uint8_t fg, bg;
+
+    if(code == 0) {
+        esc->fg = attrib & 0x0F;
+        esc->bg = attrib >> 4;
+        esc->bold = 0;
+        esc->reverse = 0;
+    } else if(code == 1) {
+        esc->bold = 1;
+    } else if(code == 22) {
+        esc->bold = 0;
+    } else if(code == 7) {
+        esc->reverse = 1;
+    } else if(code == 27) {
+        esc->reverse = 0;
+    } else if(code >= 30 && code <= 37) {
+        esc->fg = ansi_colors[code - 30];
+    } else if(code == 39) {
+        esc->fg = attrib & 0x0F;
+    } else if(code >= 40 && code <= 47) {
+        esc->bg = ansi_colors[code - 40];
+    } else if(code == 49) {
+        esc->bg = attrib >> 4;
+    } else if(code >= 90 && code <= 97) {
+        esc->fg = ansi_colors[code - 90] | 0x08;
+    }
 
-    if(cur_pid != -1)
-        cli();
+    fg = esc->fg | (esc->bold ? 0x08 : 0);
+    bg = esc->bg;
+    esc->attr = esc->reverse ? ((fg << 4) | (bg & 0x0F)) & 0x7F : (bg << 4) | fg;
+}
 
-    int term;
+/* void term_erase(int32_t term, int32_t from, int32_t to);
+ * Inputs: term = terminal number
+ *         from, to = first and one past the last cell of the screen to blank
+ * Return Value: none
+ *  Function: Blanks cells with the current background, caller holds term_lock */
+static void term_erase(int32_t term, int32_t from, int32_t to) {
+    if(to > from)
+        memset_word(term_screen(term) + from, (term_esc[term].attr << 8) | ' ', to - from);
+}
 
-    term = pcb_ptr_array[cur_pid]->term_id;
+/* void term_csi(int32_t term, uint8_t final);
+ * Inputs: term = terminal number
+ *         final = last character of the control sequence
+ * Return Value: none
+ *  Function: Carries out a control sequence, caller holds term_lock. Supports
+ *            cursor movement (A B C D H f), erasing (J K), colors (m), the scroll
+ *            region (r) and saving the cursor (s u). Others are ignored */
+static void term_csi(int32_t term, uint8_t final) {
+    term_esc_t* esc = &term_esc[term];
+    int32_t* p = esc->params;
+    int32_t n = (p[0] > 0) ? p[0] : 1;
+    int32_t x = screen_x[term], y = screen_y[term];
+    int32_t cur = y * NUM_COLS + x;
+    int32_t i;
 
-    uint8_t color = (term == 0) ? ATTRIB_G : (term == 1) ? ATTRIB_Y : ATTRIB_W;
+    if(esc->priv)
+        return;
+
+    switch(final) {
+        case 'A':
+            y = (y - n < 0) ? 0 : y - n;
+            break;
+        case 'B':
+            y = (y + n >= NUM_ROWS) ? NUM_ROWS - 1 : y + n;
+            break;
+        case 'C':
+            x = (x + n >= NUM_COLS) ? NUM_COLS - 1 : x + n;
+            break;
+        case 'D':
+            x = (x - n < 0) ? 0 : x - n;
+            break;
+        case 'H':
+        case 'f':
+            //1-based row;column, missing ones are 1
+            y = (p[0] > 0) ? p[0] - 1 : 0;
+            x = (esc->nparams > 1 && p[1] > 0) ? p[1] - 1 : 0;
+            if(y >= NUM_ROWS) y = NUM_ROWS - 1;
+            if(x >= NUM_COLS) x = NUM_COLS - 1;
+            break;
+        case 'J':
+            if(p[0] == 0)
+                term_erase(term, cur, NUM_ROWS * NUM_COLS);
+            else if(p[0] == 1)
+                term_erase(term, 0, cur + 1);
+            else if(p[0] == 2)
+                term_erase(term, 0, NUM_ROWS * NUM_COLS);
+            break;
+        case 'K':
+            if(p[0] == 0)
+                term_erase(term, cur, (y + 1) * NUM_COLS);
+            else if(p[0] == 1)
+                term_erase(term, y * NUM_COLS, cur + 1);
+            else if(p[0] == 2)
+                term_erase(term, y * NUM_COLS, (y + 1) * NUM_COLS);
+            break;
+        case 'm':
+            for(i = 0; i < esc->nparams; i++)
+                term_sgr(esc, p[i], term_attrib[term]);
+            break;
+        case 'r':
+            //1-based top;bottom, the whole screen when missing or backwards
+            esc->top = (p[0] > 0) ? p[0] - 1 : 0;
+            esc->bottom = (esc->nparams > 1 && p[1] > 0 && p[1] <= NUM_ROWS) ? p[1] - 1 : NUM_ROWS - 1;
+            if(esc->top >= esc->bottom) {
+                esc->top = 0;
+                esc->bottom = NUM_ROWS - 1;
+            }
+            x = 0;
+            y = 0;
+            break;
+        case 's':
+            esc->saved_x = x;
+            esc->saved_y = y;
+            break;
+        case 'u':
+            x = esc->saved_x;
+            y = esc->saved_y;
+            break;
+        default:
+            break;
+    }
 
+    screen_x[term] = x;
+    screen_y[term] = y;
+}
 
-    char* term_mem = video_mem;
+/* int32_t term_escape(int32_t term, const uint8_t* buf, int32_t n);
+ * Inputs: term = terminal number
+ *         buf = output starting with or inside an escape sequence
+ *         n = number of characters
+ * Return Value: number of characters used, all n if the sequence is not finished
+ *  Function: Feeds characters to the terminal's escape sequence parser, caller
+ *            holds term_lock. The parser state is kept per terminal so a sequence
+ *            can be split across writes. ESC 7 and ESC 8 save and restore the cursor */
+static int32_t term_escape(int32_t term, const uint8_t* buf, int32_t n) {
+    term_esc_t* esc = &term_esc[term];
+    int32_t i;
 
-    if(cur_pid > -1 && cur_pid < MAX_PCBS){
-        if(pcb_ptr_array[cur_pid] != NULL){
-            if(cur_term != term){
-                switch(pcb_ptr_array[cur_pid]->term_id) {
-                    case 0:
-                        term_mem = (char *)TERM1_ADDR;
-                        break;
-                    case 1:
-                        term_mem = (char *)TERM2_ADDR;
-                        break;
-                    case 2:
-                        term_mem = (char *)TERM3_ADDR;
-                        break;
+    for(i = 0; i < n; i++) {
+        uint8_t c = buf[i];
+        switch(esc->state) {
+            case ESC_NONE:
+                esc->state = ESC_START;
+                break;
+            case ESC_START:
+                if(c == '[') {
+                    esc->state = ESC_CSI;
+                    esc->priv = 0;
+                    esc->nparams = 1;
+                    memset(esc->params, 0, sizeof(esc->params));
+                    break;
                 }
-            }
+                if(c == '7') {
+                    esc->saved_x = screen_x[term];
+                    esc->saved_y = screen_y[term];
+                } else if(c == '8') {
+                    screen_x[term] = esc->saved_x;
+                    screen_y[term] = esc->saved_y;
+                }
+                esc->state = ESC_NONE;
+                return i + 1;
+            default:
+                if(c >= '0' && c <= '9') {
+                    int32_t* p = &esc->params[esc->nparams - 1];
+                    if(*p <= ESC_MAX_VALUE)
+                        *p = *p * 10 + (c - '0');
+                } else if(c == ';') {
+                    //extra parameters all land in the last one
+                    if(esc->nparams < ESC_MAX_PARAMS)
+                        esc->nparams++;
+                } else if(c == '?') {
+                    esc->priv = 1;
+                } else if(c >= '@' && c <= '~') {
+                    term_csi(term, c);
+                    esc->state = ESC_NONE;
+                    return i + 1;
+                }
+                break;
         }
     }
+    return n;
+}
 
-  if(c == BACKSPACE) { //added functionality for backspace
-    if(screen_x[term] > 0) { //move cursor 1 space back
-      screen_x[term] = screen_x[term] - 1;
-    }
-    else if(screen_x[term] == 0 && screen_y[term] > 0) { //sanity check for beginning of lines
-      screen_x[term] = NUM_COLS - 1;
-      screen_y[term] = screen_y[term] - 1;
+/* int32_t term_write(int32_t visible, const uint8_t* buf, int32_t n);
+ * Inputs: visible = 1 to print to the terminal on screen, 0 for the current process's
+ *         buf = characters to print
+ *         n = number of characters
+ * Return Value: number of characters printed
+ *  Function: Splits the output into runs of plain text and escape sequences.
+ *            Plain text only costs a check for ESC per character. term_lock is
+ *            taken for TERM_CHUNK bytes at a time so a long write doesn't keep
+ *            interrupts off. The cursor only moves in memory, callers move the
+ *            hardware one with update_cursor */
+static int32_t term_write(int32_t visible, const uint8_t* buf, int32_t n) {
+    int32_t term, i, j, end;
+    uint32_t flags;
+    term_esc_t* esc;
+
+    if(n <= 0) return 0;
+
+    term = visible ? cur_term : pcb_ptr_array[cur_pid]->term_id;
+    esc = &term_esc[term];
+
+    for(i = 0; i < n; ) {
+        end = (n - i > TERM_CHUNK) ? i + TERM_CHUNK : n;
+        flags = spin_lock_irqsave(&term_lock);
+        for(; i < end; i = j) {
+            if(esc->state != ESC_NONE || buf[i] == ESC) {
+                j = i + term_escape(term, buf + i, end - i);
+                continue;
+            }
+            for(j = i; j < end && buf[j] != ESC; j++);
+            if(esc->top == 0 && esc->bottom == NUM_ROWS - 1)
+                term_text(term, buf + i, j - i);
+            else
+                term_text_region(term, buf + i, j - i);
+        }
+        spin_unlock_irqrestore(&term_lock, flags);
     }
-    *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1)) = ' '; //fill with empty character for illusion of backspace
-    *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1) + 1) = color;
+    return n;
+}
 
-    if(cur_pid != -1)
-        sti();
-    
-    update_cursor(); //update cursor here and return to avoid unnecessary conflicts
+/* void putc(uint8_t c);
+ * Inputs: uint_8* c = character to print
+ * Return Value: void
+ *  Function: Output a character to the console, the caller moves the cursor */
+void putc(uint8_t c) {
+    term_write(1, &c, 1);
+}
 
-    return;
-  }
+/* void putc_syscall(uint8_t c);
+ * Inputs: uint_8* c = character to print
+ * Return Value: void
+ *  Function: Output a character to the terminal of the current process, the
+ *            caller moves the cursor */
+void putc_syscall(uint8_t c) {
+    term_write(0, &c, 1);
+}
 
-                                 //test here to fix bug where line was being overwritten. Move to next line to avoid error
-    if(c == '\n' || c == '\r' /*((screen_x[term] == NUM_COLS) && screen_y[term] != NUM_ROWS - 1)*/) {
-        screen_y[term]++;
-        screen_x[term] = 0;
-    } else {
-        *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1)) = c;
-        *(uint8_t *)(term_mem + ((NUM_COLS * screen_y[term] + screen_x[term]) << 1) + 1) = color;
-        screen_x[term]++;
-        //screen_x[term] %= NUM_COLS;
-        screen_y[term] = (screen_y[term] + (screen_x[term] / NUM_COLS));
-    }
-
-    if(((screen_x[term] == NUM_COLS) && screen_y[term] != NUM_ROWS)) {
-      screen_x[term] = 0;
-    }
-
-    if( screen_y[term] >= NUM_ROWS) {
-      int32_t i;                                      //clear first row and
-      for (i = 0; i < (NUM_ROWS - 1) * NUM_COLS; i++) //move each row below the first up one.
-      {   //shifts everything up one line
-          *(uint8_t *)(term_mem + (i << 1)) = *(uint8_t *)(term_mem + ((NUM_COLS + i) << 1));
-          *(uint8_t *)(term_mem + (i << 1) + 1) = *(uint8_t *)(term_mem + ((NUM_COLS + i) << 1) + 1);
-      }
-      for(i = (NUM_ROWS - 1) * NUM_COLS; i < NUM_ROWS * NUM_COLS; i++) //clear last row
-      {
-          *(uint8_t *)(term_mem + (i << 1)) = ' ';
-          *(uint8_t *)(term_mem + (i << 1) + 1) = color;
-      }
-      //reset screen values and update cursor to give illusion of scrolling
-      screen_x[term] = 0;
-      screen_y[term] = NUM_ROWS - 1;
-    }
-
-    if(cur_pid != -1)
-        sti();
-    
-    update_cursor(); //just universally do this for all calls
-    return;
+/* int32_t putbuf_syscall(const uint8_t* buf, int32_t n);
+ * Inputs: buf = characters to print
+ *         n = number of characters
+ * Return Value: number of characters printed
+ *  Function: Output a buffer to the terminal of the current process */
+int32_t putbuf_syscall(const uint8_t* buf, int32_t n) {
+    n = term_write(0, buf, n);
+    update_cursor();
+    return n;
 }
 
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
@@ -738,6 +1232,6 @@ int8_t* strncpy(int8_t* dest, const int8_t* src, uint32_t n) {
 void test_interrupts(void) {
     int32_t i;
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-        video_mem[i << 1]++;
+        ((char*)term_screen(cur_term))[i << 1]++;
     }
 }
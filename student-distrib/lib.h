@@ -8,11 +8,13 @@
 #include "types.h"
 #include "keyboard.h"
 #include "terminal.h"
+#include "lock.h"
 
 extern void test_interrupts(void);
 
 int32_t printf(int8_t *format, ...);
 void putc_syscall(uint8_t c) ;
+int32_t putbuf_syscall(const uint8_t* buf, int32_t n);
 void putc(uint8_t c);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
@@ -22,6 +24,12 @@ void clear(void);
 void BSOD(char* str);
 void update_cursor(void);
 void reset_cursor(void);
+//VGA CRTC port writes made moving the cursor and display start
+extern uint32_t vga_port_writes;
+void switch_screen(int32_t term);
+void screen_pin(int32_t term, int32_t pin);
+void scrollback_page(int32_t dir);
+void scrollback_reset(void);
 
 void* memset(void* s, int32_t c, uint32_t n);
 void* memset_word(void* s, int32_t c, uint32_t n);
@@ -103,27 +111,41 @@ do {                                    \
 /* Writes four bytes to four consecutive ports */
 #define outl(data, port)                \
 do {                                    \
-    asm volatile ("outl %l1, (%w0)"     \
+    asm volatile ("outl %k1, (%w0)"     \
             :                           \
             : "d"(port), "a"(data)      \
             : "memory", "cc"            \
     );                                  \
 } while (0)
 
+/* Where interrupts were turned off, "file.c:123", for irq_off_max_lock */
+#define IRQ_OFF_STR2(x) #x
+#define IRQ_OFF_STR(x) IRQ_OFF_STR2(x)
+#define IRQ_OFF_WHERE __FILE__ ":" IRQ_OFF_STR(__LINE__)
+
 /* Clear interrupt flag - disables interrupts on this processor */
 #define cli()                           \
 do {                                    \
-    asm volatile ("cli"                 \
-            :                           \
+    uint32_t cli_flags;                 \
+    asm volatile ("                   \n\
+            pushfl                    \n\
+            popl %0                   \n\
+            cli                       \n\
+            "                           \
+            : "=r"(cli_flags)           \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    irq_off_begin(cli_flags, IRQ_OFF_WHERE); \
 } while (0)
 
 /* Save flags and then clear interrupt flag
  * Saves the EFLAGS register into the variable "flags", and then
  * disables interrupts on this processor */
-#define cli_and_save(flags)             \
+#define cli_and_save(flags) cli_and_save_named(flags, IRQ_OFF_WHERE)
+
+/* cli_and_save, with the section timed under name instead of file:line */
+#define cli_and_save_named(flags, name) \
 do {                                    \
     asm volatile ("                   \n\
             pushfl                    \n\
@@ -134,11 +156,13 @@ do {                                    \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    irq_off_begin(flags, name);         \
 } while (0)
 
 /* Set interrupt flag - enable interrupts on this processor */
 #define sti()                           \
 do {                                    \
+    irq_off_end();                      \
     asm volatile ("sti"                 \
             :                           \
             :                           \
@@ -151,6 +175,8 @@ do {                                    \
  * after a cli_and_save_flags(flags) */
 #define restore_flags(flags)            \
 do {                                    \
+    if((flags) & EFLAGS_IF)             \
+        irq_off_end();                  \
     asm volatile ("                   \n\
             pushl %0                  \n\
             popfl                     \n\
@@ -161,4 +187,47 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Read time stamp counter
+ * Returns the low 32 bits of the TSC, enough to time short intervals
+ * as long as deltas are taken with unsigned arithmetic */
+static inline uint32_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc"
+            : "=a"(lo), "=d"(hi)
+            :
+            : "memory"
+    );
+    return lo;
+}
+
+/* Read the full 64-bit time stamp counter */
+static inline uint64_t rdtsc64(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc"
+            : "=a"(lo), "=d"(hi)
+            :
+            : "memory"
+    );
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Write a model specific register */
+static inline void wrmsr(uint32_t msr, uint64_t val) {
+    asm volatile ("wrmsr"
+            :
+            : "c"(msr), "a"((uint32_t)val), "d"((uint32_t)(val >> 32))
+            : "memory"
+    );
+}
+
+/* Read the edx feature flags of cpuid leaf 1 */
+static inline uint32_t cpuid_features(void) {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile ("cpuid"
+            : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+            : "a"(1)
+    );
+    return edx;
+}
+
 #endif /* _LIB_H */
@@ -0,0 +1,145 @@
+#include "lock.h"
+#include "lib.h"
+#include "vdso.h"
+
+volatile uint32_t irq_off_max = 0;
+const char* volatile irq_off_max_lock = NULL;
+// the section being timed, processes only run on the BSP so one is enough
+static uint32_t irq_off_start;
+static const char* irq_off_from;
+static uint8_t irq_off_timing = 0;
+
+/* uint32_t xchg(volatile uint32_t* addr, uint32_t val);
+ * Inputs: addr - word to swap
+ *         val - new value
+ * Return Value: old value
+ * Function: Atomic swap, xchg with memory is locked without a prefix */
+static inline uint32_t xchg(volatile uint32_t* addr, uint32_t val){
+    asm volatile("xchgl %0, %1"
+                 : "+r"(val), "+m"(*addr)
+                 :
+                 : "memory"
+                );
+    return val;
+}
+
+/* int32_t lock_cpu(void);
+ * Inputs: void
+ * Return Value: id of the processor taking or checking a lock
+ * Function: Processes only run on the BSP and the APs park with interrupts off
+ *           without touching a lock, so this is always 0. this_cpu() would read
+ *           the local APIC on every acquire for nothing until APs run code */
+static inline int32_t lock_cpu(void){
+    return 0;
+}
+
+/* void spin_lock(spinlock_t* lock);
+ * Inputs: lock - lock to take
+ * Return Value: none
+ * Function: Spins until the lock is free. Only reads while it waits so the
+ *           cache line is not bounced between processors. Taking a lock this
+ *           processor already holds would never return, so it is a BSOD instead */
+void spin_lock(spinlock_t* lock){
+    int32_t id = lock_cpu();
+
+    if(lock->locked && lock->owner == id){
+        BSOD("spin_lock: lock already held by this processor");
+    }
+    while(xchg(&lock->locked, 1)){
+        while(lock->locked){
+            asm volatile("pause");
+        }
+    }
+    lock->owner = id;
+    lock->owner_eip = (uint32_t)__builtin_return_address(0);
+}
+
+/* void spin_unlock(spinlock_t* lock);
+ * Inputs: lock - lock to release
+ * Return Value: none
+ * Function: Releases a lock held by this processor */
+void spin_unlock(spinlock_t* lock){
+    if(!lock->locked || lock->owner != lock_cpu()){
+        BSOD("spin_unlock: lock not held by this processor");
+    }
+    lock->owner = NO_OWNER;
+    xchg(&lock->locked, 0);
+}
+
+/* uint32_t spin_lock_irqsave(spinlock_t* lock);
+ * Inputs: lock - lock to take
+ * Return Value: flags from before interrupts were turned off
+ * Function: Turns interrupts off and takes the lock, for state that interrupt
+ *           handlers also touch. Starts timing when this is what disabled them */
+uint32_t spin_lock_irqsave(spinlock_t* lock){
+    uint32_t flags;
+
+    // the section is timed once, named after the lock rather than lock.c
+    cli_and_save_named(flags, lock->name);
+    spin_lock(lock);
+    return flags;
+}
+
+/* void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags);
+ * Inputs: lock - lock to release
+ *         flags - value spin_lock_irqsave returned
+ * Return Value: none
+ * Function: Releases the lock and puts interrupts back the way they were,
+ *           restore_flags times the section */
+void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags){
+    spin_unlock(lock);
+    restore_flags(flags);
+}
+
+/* void irq_off_record(uint32_t start, const char* name);
+ * Inputs: start - rdtsc() when interrupts went off
+ *         name - what kept them off, a lock or an interrupt handler
+ * Return Value: none
+ * Function: Records the interval if it is the longest seen so far */
+void irq_off_record(uint32_t start, const char* name){
+    uint32_t off = rdtsc() - start;
+
+    if(off > irq_off_max){
+        irq_off_max = off;
+        irq_off_max_lock = name;
+        vdso_set_irq_off_max(off, name);
+    }
+}
+
+/* void irq_off_begin(uint32_t flags, const char* name);
+ * Inputs: flags - EFLAGS from before interrupts were turned off
+ *         name - what turned them off
+ * Return Value: none
+ * Function: Starts timing an interrupts-off section if interrupts were on before.
+ *           Interrupt gates pass EFLAGS_IF since they just turned them off */
+void irq_off_begin(uint32_t flags, const char* name){
+    if(flags & EFLAGS_IF){
+        irq_off_start = rdtsc();
+        irq_off_from = name;
+        irq_off_timing = 1;
+    }
+}
+
+/* void irq_off_end(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Called with interrupts off right before they go back on. The section
+ *           can have started in another process, sched switches with them off */
+void irq_off_end(){
+    uint32_t flags;
+
+    // an iret or sysexit may have turned them on without us seeing it
+    asm volatile("pushfl; popl %0" : "=r"(flags));
+    if(irq_off_timing && !(flags & EFLAGS_IF)){
+        irq_off_record(irq_off_start, irq_off_from);
+    }
+    irq_off_timing = 0;
+}
+
+/* int32_t spin_is_held(spinlock_t* lock);
+ * Inputs: lock - lock to check
+ * Return Value: nonzero if this processor holds the lock
+ * Function: For asserting a caller holds a lock */
+int32_t spin_is_held(spinlock_t* lock){
+    return lock->locked && lock->owner == lock_cpu();
+}
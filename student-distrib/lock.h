@@ -0,0 +1,48 @@
+#ifndef _LOCK_H
+#define _LOCK_H
+
+// interrupt flag in EFLAGS
+#define EFLAGS_IF 0x200
+// owner of a lock nobody holds
+#define NO_OWNER -1
+
+#ifndef ASM
+
+#include "types.h"
+
+/*
+    Spinlock. owner and owner_eip record which processor took the lock and
+    from where, so a lock taken twice or released by the wrong processor is
+    caught instead of deadlocking
+*/
+typedef struct spinlock{
+    volatile uint32_t locked;
+    const char* name;
+    volatile int32_t owner;
+    uint32_t owner_eip;
+} spinlock_t;
+
+#define SPINLOCK_INIT(lock_name) {0, lock_name, NO_OWNER, 0}
+
+// longest time interrupts were off, in TSC cycles, and what turned them off: a
+// lock, an interrupt or the file:line of a cli. cli/sti and friends in lib.h time
+// every section, only the few instructions around sysenter/sysexit and iret are missed
+extern volatile uint32_t irq_off_max;
+extern const char* volatile irq_off_max_lock;
+
+void spin_lock(spinlock_t* lock);
+void spin_unlock(spinlock_t* lock);
+// takes the lock with interrupts off, returns the flags to hand back to spin_unlock_irqrestore
+uint32_t spin_lock_irqsave(spinlock_t* lock);
+void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags);
+// nonzero if the calling processor holds the lock
+int32_t spin_is_held(spinlock_t* lock);
+// counts an interrupts-off section that started at rdtsc() start towards irq_off_max
+void irq_off_record(uint32_t start, const char* name);
+// interrupts were just turned off, flags are from before; starts timing if they were on
+void irq_off_begin(uint32_t flags, const char* name);
+// interrupts are about to go back on, records the section irq_off_begin started
+void irq_off_end(void);
+
+#endif /* ASM */
+#endif
@@ -1,6 +1,17 @@
 #include "paging.h"
 #include "paging_asm.h"
 
+spinlock_t page_lock = SPINLOCK_INIT("page");
+
+//shared memory window of each process, switched in with its program page
+static uint32_t shm_page_tables[MAX_PCBS][ONE_KB] __attribute__((aligned (FOUR_KB)));
+//vidmap page of each terminal, the start of its text memory
+static uint32_t video_page_tables[NUM_OF_TERMINALS][ONE_KB] __attribute__((aligned (FOUR_KB)));
+//vidmap page of each process drawing into a back buffer
+static uint32_t vidbuf_page_tables[MAX_PCBS][ONE_KB] __attribute__((aligned (FOUR_KB)));
+//framebuffer window, only present for the process that mapped it
+static uint32_t fb_page_tables[FB_WINDOW / FOUR_MB][ONE_KB] __attribute__((aligned (FOUR_KB)));
+
 /*
 * init_paging
 * Description: initializes paging by creating and initializing
@@ -13,30 +24,23 @@ void init_paging(void) {
   // initialize page directory to 2 (not present) and page table values to 0
   memset(page_directory, NOT_PRESENT, ONE_KB*sizeof(uint32_t));
 
-  // initialize video page table for user programs to access screen as not present
-  memset(video_page_table, NOT_PRESENT, ONE_KB*sizeof(uint32_t));
-
-  // Note that KB4 is defined with respect to a 4B pointer so need to multiply by 4 to get 4096
-  video_page_table[0] = (uint32_t)(VID_ADDR) | USER_ATTRIBUTES;
-  video_page_table[1] = (uint32_t)(TERM1_ADDR) | USER_ATTRIBUTES;
-  video_page_table[2] = (uint32_t)(TERM2_ADDR) | USER_ATTRIBUTES;
-  video_page_table[3] = (uint32_t)(TERM3_ADDR) | USER_ATTRIBUTES;
-
+  int i; //loop counter
 
+  // video page tables for user programs map the first page of a terminal's text memory at 132MB
+  for(i = 0; i < NUM_OF_TERMINALS; i++){
+    memset(video_page_tables[i], NOT_PRESENT, ONE_KB*sizeof(uint32_t));
+    video_page_tables[i][0] = (uint32_t)TERM_VID_ADDR(i) | USER_ATTRIBUTES;
+  }
 
   //set page_table at 0 to 0
   page_table[0] = ZERO;
 
-  int i; //loop counter
   for(i = 1; i < ONE_KB; i++)
     page_table[i] = NOT_PRESENT | (i * SCALE); //4 B per 4 KB
 
-  //accounting for kernel
-  page_table[VIDEO_MEMORY] = page_table[VIDEO_MEMORY] | PRESENT;
-  //page attributes are "present" and "user mode"
-  page_table[VIDEO_MEMORY + 1] = page_table[VIDEO_MEMORY + 1] | PAGE_ATTRIBUTES;
-  page_table[VIDEO_MEMORY + 2] = page_table[VIDEO_MEMORY + 2] | PAGE_ATTRIBUTES;
-  page_table[VIDEO_MEMORY + 3] = page_table[VIDEO_MEMORY + 3] | PAGE_ATTRIBUTES;
+  //accounting for kernel, the text memory of all three terminals and the history view
+  for(i = VID_ADDR; i < VIEW_VID_ADDR + VID_RING_SIZE; i += FOUR_KB)
+    page_table[i >> PAGE_OFFSET] = page_table[i >> PAGE_OFFSET] | PRESENT;
 
 
   //add page table to page directory
@@ -47,6 +51,11 @@ void init_paging(void) {
   //supervisor attributes indicate page is present, writeable, and in supervisor mode (011)
   page_directory[1] = SUP_ATTRIBUTES | KERNEL_ADDRESS | PAGE_SIZE;
 
+  //process pages at their physical address, supervisor only, so execute can copy
+  //a program in without mapping it at 128MB
+  for(i = 0; i < MAX_PCBS; i++)
+    page_directory[TASK_ADDRESS(i) >> DIR_OFFSET] = SUP_ATTRIBUTES | TASK_ADDRESS(i) | PAGE_SIZE;
+
   //clear();
 
   //call x86 methods to load directory and enable paging
@@ -56,22 +65,15 @@ void init_paging(void) {
 
 /*
 * new_task_page
-* Description: allocates memory for and creates place for new task page
+* Description: gets the page of a new task ready. The program is copied in
+  through the kernel mapping at TASK_ADDRESS(pid), switch_task_page maps it at
+  128 MB once the task runs. Caller holds page_lock
 * Inputs: pid
 * Outputs: none
-* Side effects: adds entry into page directory
+* Side effects: empties the pid's shared memory window
 */
 void new_task_page(uint32_t pid) {
-  //allocate space for new task
-  
-  uint32_t task_address;
-
-  task_address = ((FOUR_MB*pid) + EIGHT_MB);
-
-  // 32 in page directory is at 128 MB
-  // User attributes indicate user mode, writeable page, and present page (111)
-  page_directory[32] = task_address | PAGE_SIZE | USER_ATTRIBUTES;
-  flush_tlb();
+  memset(shm_page_tables[pid], NOT_PRESENT, ONE_KB*sizeof(uint32_t));
   return;
 }
 /*
@@ -79,17 +81,31 @@ void new_task_page(uint32_t pid) {
 * Description: switches the page
 * Inputs: pid
 * Outputs: none
-* Side effects: switches the page
+* Side effects: switches the page, the shared memory window and the vidmap page
 */
 void switch_task_page(uint32_t pid) {
   //allocate space for new task
   uint32_t task_address;
-  task_address = ((FOUR_MB*pid) + EIGHT_MB);
+  uint32_t flags;
+  uint32_t i;
+  task_address = TASK_ADDRESS(pid);
 
   // 32 in page directory is at 128 MB
   // User attributes indicate user mode, writeable page, and present page (111)
+  flags = spin_lock_irqsave(&page_lock);
   page_directory[32] = task_address | PAGE_SIZE | USER_ATTRIBUTES;
+  page_directory[SHM_ADDR >> DIR_OFFSET] = USER_ATTRIBUTES | ((uint32_t)shm_page_tables[pid]);
+  if(pcb_ptr_array[pid]->vidmap_buffered != VIDBUF_OFF)
+    page_directory[33] = USER_ATTRIBUTES | ((uint32_t)vidbuf_page_tables[pid]);
+  else if(pcb_ptr_array[pid]->vidmap_ptr != NULL)
+    page_directory[33] = USER_ATTRIBUTES | ((uint32_t)video_page_tables[pcb_ptr_array[pid]->term_id]);
+  else
+    page_directory[33] = NOT_PRESENT;
+  for(i = 0; i < FB_WINDOW / FOUR_MB; i++)
+    page_directory[(FB_ADDR >> DIR_OFFSET) + i] = pcb_ptr_array[pid]->fb_mapped ?
+      USER_ATTRIBUTES | ((uint32_t)fb_page_tables[i]) : NOT_PRESENT;
   flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
   return;
 }
 
@@ -110,54 +126,64 @@ void flush_tlb() {
 
 /*
 * vidmap_init
-* Description: allocates page for new process
+* Description: maps the text memory of the current process's terminal for it
 * Inputs: None
 * Outputs: address of page
 * Side effects : creates page and allows user to write to its video memory
 */
 uint8_t* vidmap_init() {
-  //only one process at a time for now so allocate it this way
   uint32_t virtual_addr = MB132;
   uint32_t running_term = pcb_ptr_array[cur_pid]->term_id;
+  uint32_t flags = spin_lock_irqsave(&page_lock);
 
-  page_directory[33] = USER_ATTRIBUTES | ((uint32_t)(video_page_table));
-
-  if(cur_term != running_term){
-    video_page_table[0] = video_page_table[running_term+1];
-  }
-  else{
-    video_page_table[0] = USER_ATTRIBUTES | (uint32_t)(VID_ADDR);
-  }
+  // the terminal's text memory never moves, so switching terminals leaves this alone
+  page_directory[33] = USER_ATTRIBUTES | ((uint32_t)(video_page_tables[running_term]));
 
   //always flush
   flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
 
   return (uint8_t*)virtual_addr;
 }
 
-/*  
- *  Function updates vidmap pages when a context switch occurs
- *  NOTE: That this happens during IRQ0 handler, should not be interrupted by other interrupts
- *  Do not place in cli()/sti(). If neccesary, place critical section in sched where this is called.
- *  MAKE SURE that this function is called after cur_term is updated for new process
- *  INPUT: NONE
- *  OUTPUT: NONE
- *  SIDEEFFECT: remaps page at 132MB depending on the new process. 
- */
-void update_vidmap(){
-  int32_t running_term = pcb_ptr_array[cur_pid]->term_id;
-
-  page_directory[33] = (uint32_t)(USER_ATTRIBUTES | ((uint32_t)(video_page_table)));
-
-  if(running_term != cur_term){
-    video_page_table[0] = video_page_table[running_term+1];
-  }
-  else{
-    video_page_table[0] = (uint32_t)(USER_ATTRIBUTES | (uint32_t)(VID_ADDR));
-  }
+/*
+* vidmap_buffer_init
+* Description: maps a process's back buffer where vidmap maps text memory
+* Inputs: pid - process, the current one
+*         page - 4KB aligned kernel address of the back buffer
+* Outputs: address of page
+* Side effects : the back buffer starts out clean
+*/
+uint8_t* vidmap_buffer_init(uint32_t pid, uint32_t page) {
+  uint32_t flags = spin_lock_irqsave(&page_lock);
 
+  memset(vidbuf_page_tables[pid], NOT_PRESENT, ONE_KB*sizeof(uint32_t));
+  vidbuf_page_tables[pid][0] = page | USER_ATTRIBUTES;
+  page_directory[33] = USER_ATTRIBUTES | ((uint32_t)vidbuf_page_tables[pid]);
   flush_tlb();
-  return;
+  spin_unlock_irqrestore(&page_lock, flags);
+
+  return (uint8_t*)MB132;
+}
+
+/*
+* vidmap_buffer_dirty
+* Description: checks and clears the dirty bit of a process's back buffer page
+* Inputs: pid - process with a back buffer
+* Outputs: 1 if the page was written since the last call, 0 otherwise
+* Side effects : flushes the TLB when the bit was set, so the next write sets it again
+*/
+uint32_t vidmap_buffer_dirty(uint32_t pid) {
+  uint32_t dirty;
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+
+  dirty = vidbuf_page_tables[pid][0] & DIRTY;
+  if(dirty) {
+    vidbuf_page_tables[pid][0] &= ~DIRTY;
+    flush_tlb();
+  }
+  spin_unlock_irqrestore(&page_lock, flags);
+  return dirty ? 1 : 0;
 }
 
 /*
@@ -171,7 +197,134 @@ void vidmap_close(){
   //set all positions in vidmap_init to not PRESENT
   //as a proper way to deallocate the page
 
+  uint32_t flags = spin_lock_irqsave(&page_lock);
   page_directory[33] = NOT_PRESENT;
   flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
   return;
 }
+
+/*
+* identity_map_page
+* Description: makes a kernel page in the first 4MB present at its physical address
+* Inputs: addr - any address in the page
+* Outputs: none
+* Side effects: edits page_table
+*/
+void identity_map_page(uint32_t addr){
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+  page_table[(addr >> PAGE_OFFSET) & (ONE_KB - 1)] |= PRESENT;
+  flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
+}
+
+/*
+* map_mmio
+* Description: maps the 4MB region holding addr at its physical address for device registers
+* Inputs: addr - physical address of the registers
+* Outputs: none
+* Side effects: adds a supervisor, uncached 4MB entry to the page directory
+*/
+void map_mmio(uint32_t addr){
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+  page_directory[addr >> DIR_OFFSET] = (addr & ~(FOUR_MB - 1)) | PAGE_SIZE | NO_CACHE | SUP_ATTRIBUTES;
+  flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
+}
+
+/*
+* map_vdso_page
+* Description: maps a kernel page at VDSO_ADDR for every process, user readable but not writable
+* Inputs: page - 4KB aligned kernel address of the page
+* Outputs: none
+* Side effects: adds a page table for the 4MB at VDSO_ADDR to the page directory
+*/
+void map_vdso_page(uint32_t page){
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+  memset(vdso_page_table, NOT_PRESENT, ONE_KB*sizeof(uint32_t));
+  //present and user mode, read only
+  vdso_page_table[0] = page | PAGE_ATTRIBUTES;
+  page_directory[VDSO_ADDR >> DIR_OFFSET] = USER_ATTRIBUTES | ((uint32_t)vdso_page_table);
+  flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
+}
+
+/*
+* map_shm_pages
+* Description: maps shared memory pages into a process's window, user read/write
+* Inputs: pid - process whose window changes
+*         addr - page aligned user address inside the window
+*         frames - 4KB aligned kernel addresses of the pages
+*         n - number of pages
+* Outputs: none
+* Side effects: edits the pid's shared memory page table
+*/
+void map_shm_pages(int32_t pid, uint32_t addr, uint32_t* frames, uint32_t n){
+  uint32_t i;
+  uint32_t first = (addr - SHM_ADDR) >> PAGE_OFFSET;
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+  for(i = 0; i < n; i++)
+    shm_page_tables[pid][first + i] = frames[i] | USER_ATTRIBUTES;
+  flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
+}
+
+/*
+* unmap_shm_pages
+* Description: removes pages from a process's shared memory window
+* Inputs: pid - process whose window changes
+*         addr - page aligned user address inside the window
+*         n - number of pages
+* Outputs: none
+* Side effects: edits the pid's shared memory page table
+*/
+void unmap_shm_pages(int32_t pid, uint32_t addr, uint32_t n){
+  uint32_t i;
+  uint32_t first = (addr - SHM_ADDR) >> PAGE_OFFSET;
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+  for(i = 0; i < n; i++)
+    shm_page_tables[pid][first + i] = NOT_PRESENT;
+  flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
+}
+
+/*
+* map_fb_pages
+* Description: maps the framebuffer at FB_ADDR for the current process, user
+  read/write and write-through
+* Inputs: phys - physical address of the first pixel
+*         bytes - size of the framebuffer, at most FB_WINDOW less a page
+* Outputs: user address of the first pixel
+* Side effects: switch_task_page keeps it mapped while pcb fb_mapped is set
+*/
+uint32_t map_fb_pages(uint32_t phys, uint32_t bytes){
+  uint32_t i;
+  uint32_t first = phys & ~(FOUR_KB - 1);
+  uint32_t pages = ((phys - first) + bytes + FOUR_KB - 1) / FOUR_KB;
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+
+  memset(fb_page_tables, NOT_PRESENT, sizeof(fb_page_tables));
+  for(i = 0; i < pages; i++)
+    fb_page_tables[i / ONE_KB][i % ONE_KB] = (first + i * FOUR_KB) | WRITE_THROUGH | USER_ATTRIBUTES;
+  for(i = 0; i < FB_WINDOW / FOUR_MB; i++)
+    page_directory[(FB_ADDR >> DIR_OFFSET) + i] = USER_ATTRIBUTES | ((uint32_t)fb_page_tables[i]);
+  flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
+  return FB_ADDR + (phys - first);
+}
+
+/*
+* unmap_fb_pages
+* Description: removes the framebuffer from FB_ADDR
+* Inputs: none
+* Outputs: none
+* Side effects: edits the page directory
+*/
+void unmap_fb_pages(void){
+  uint32_t i;
+  uint32_t flags = spin_lock_irqsave(&page_lock);
+  for(i = 0; i < FB_WINDOW / FOUR_MB; i++)
+    page_directory[(FB_ADDR >> DIR_OFFSET) + i] = NOT_PRESENT;
+  flush_tlb();
+  spin_unlock_irqrestore(&page_lock, flags);
+}
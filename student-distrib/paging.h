@@ -5,6 +5,10 @@
 #include "types.h"
 #include "lib.h"
 #include "system_calls.h"
+#include "lock.h"
+#include "vdso_data.h"
+#include "shm_data.h"
+#include "fb_data.h"
 
 //magic numbers
 #define ONE_KB 1024
@@ -12,6 +16,8 @@
 #define FOUR_MB 0x400000
 #define EIGHT_MB 0x800000
 #define KERNEL_ADDRESS 0x00400000
+//physical address of a process's 4MB page, the kernel also maps it there
+#define TASK_ADDRESS(pid) (EIGHT_MB + FOUR_MB * (pid))
 
 //more magic numbers
 #define PRESENT 0x00000001
@@ -19,29 +25,54 @@
 #define SUP_ATTRIBUTES 0x00000003
 #define USER_ATTRIBUTES 0x00000007
 #define PAGE_ATTRIBUTES 0x00000005
-#define VIDEO_MEMORY 0xB8
 #define ZERO 0x0
 #define PAGE_SIZE 0x00000080
 #define SCALE 0x00001000
 #define PAGE_OFFSET 12
+#define DIR_OFFSET 22
+//page-level write-through and cache disable, for memory mapped registers
+#define NO_CACHE 0x00000018
+//set by the processor when a page is written
+#define DIRTY 0x00000040
+//page-level write-through, for the framebuffer
+#define WRITE_THROUGH 0x00000008
 
 //declare page directory and page table and align them properly
 uint32_t page_directory[ONE_KB] __attribute__((aligned (FOUR_KB)));
 uint32_t page_table[ONE_KB] __attribute__((aligned (FOUR_KB)));
-uint32_t video_page_table[ONE_KB] __attribute__((aligned (FOUR_KB)));
+uint32_t vdso_page_table[ONE_KB] __attribute__((aligned (FOUR_KB)));
+
+//protects page_directory
+extern spinlock_t page_lock;
 
 //initialize paging
 extern void init_paging(void);
-//create page for new program
+//get a new program's page ready to be copied in at TASK_ADDRESS(pid), caller holds page_lock
 extern void new_task_page(uint32_t pid);
 //switch page for context switch in scheduling
 extern void switch_task_page(uint32_t pid);
-// function updates vidmap for current process during context switch
-extern void update_vidmap();
 //reload cr3
 extern void flush_tlb();
 //create page
 extern uint8_t* vidmap_init();
 //destroy page
 extern void vidmap_close();
+//map a process's vidmap back buffer instead of text memory
+extern uint8_t* vidmap_buffer_init(uint32_t pid, uint32_t page);
+//1 if the back buffer was written since the last call
+extern uint32_t vidmap_buffer_dirty(uint32_t pid);
+//make a page in the first 4MB present at its physical address
+extern void identity_map_page(uint32_t addr);
+//map the 4MB region holding addr at its physical address, uncached
+extern void map_mmio(uint32_t addr);
+//map a kernel page read-only for user space at VDSO_ADDR
+extern void map_vdso_page(uint32_t page);
+//map shared memory pages into a process's window at SHM_ADDR
+extern void map_shm_pages(int32_t pid, uint32_t addr, uint32_t* frames, uint32_t n);
+//remove pages from a process's shared memory window
+extern void unmap_shm_pages(int32_t pid, uint32_t addr, uint32_t n);
+//map the framebuffer at FB_ADDR for the current process, returns where phys is
+extern uint32_t map_fb_pages(uint32_t phys, uint32_t bytes);
+//remove the framebuffer from FB_ADDR
+extern void unmap_fb_pages(void);
 #endif //_PAGING_H
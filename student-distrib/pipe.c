@@ -0,0 +1,287 @@
+#include "pipe.h"
+#include "system_calls.h"
+#include "sched.h"
+
+/*
+	A pipe is a ring over a page of kernel memory. head and tail count every
+	byte written and read, so head - tail is what is buffered and the buffer
+	index is the count modulo PIPE_SIZE. A reader or writer that has to wait
+	leaves its pid in the pipe for the other side to wake. Everything here runs
+	with interrupts disabled, like terminal_read, so blocking can't miss a wakeup
+*/
+typedef struct pipe{
+	uint8_t* buf;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t readers;
+	uint32_t writers;
+	int32_t reader_pid;
+	int32_t writer_pid;
+	uint8_t in_use;
+} pipe_t;
+
+static uint8_t pipe_bufs[MAX_PIPES][PIPE_SIZE] __attribute__((aligned (PIPE_SIZE)));
+static pipe_t pipes[MAX_PIPES];
+
+static fops_t pipe_read_ops  = {&bad_call_open, &pipe_read,     &bad_call_write, &pipe_close};
+static fops_t pipe_write_ops = {&bad_call_open, &bad_call_read, &pipe_write,     &pipe_close};
+
+/*
+ * pipe_create
+ * DESCRIPTION: Takes a free pipe and empties it
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: pipe number, -1 if every pipe is in use
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_create (void) {
+	int32_t i;
+	uint32_t flags;
+
+	cli_and_save(flags);
+	for(i = 0; i < MAX_PIPES; i++){
+		if(!pipes[i].in_use){
+			pipes[i].in_use = 1;
+			pipes[i].buf = pipe_bufs[i];
+			pipes[i].head = 0;
+			pipes[i].tail = 0;
+			pipes[i].readers = 0;
+			pipes[i].writers = 0;
+			pipes[i].reader_pid = -1;
+			pipes[i].writer_pid = -1;
+			restore_flags(flags);
+			return i;
+		}
+	}
+	restore_flags(flags);
+	return -1;
+}
+
+/*
+ * pipe_free
+ * DESCRIPTION: Gives back a pipe whose ends were never attached, pipes with
+ * 				ends are freed when the last one is closed
+ * INPUT: pipe - pipe number from pipe_create
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: none
+ */
+void pipe_free (int32_t pipe) {
+	if(pipe >= 0 && pipe < MAX_PIPES && pipes[pipe].readers == 0 && pipes[pipe].writers == 0)
+		pipes[pipe].in_use = 0;
+}
+
+/*
+ * pipe_attach
+ * DESCRIPTION: Turns a file descriptor of a process into one end of a pipe
+ * INPUT: pid - process owning the descriptor
+ * 		  fd - descriptor to replace, may be stdin or stdout
+ * 		  pipe - pipe number
+ * 		  end - PIPE_READ_END or PIPE_WRITE_END
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: counts the new reader or writer
+ */
+void pipe_attach (int32_t pid, int32_t fd, int32_t pipe, uint32_t end) {
+	file_desc_t* file = &pcb_ptr_array[pid]->file_desc_array[fd];
+	uint32_t flags;
+
+	file->ops_table = (end == PIPE_READ_END) ? pipe_read_ops : pipe_write_ops;
+	file->inode_index = pipe;
+	file->file_position = end;
+	file->flags = 1;
+
+	cli_and_save(flags);
+	if(end == PIPE_READ_END)
+		pipes[pipe].readers++;
+	else
+		pipes[pipe].writers++;
+	restore_flags(flags);
+}
+
+/*
+ * pipe_read
+ * DESCRIPTION: Reads what is buffered, blocking until something is. Partial
+ * 				reads are normal, like reading the terminal
+ * INPUT: fd - read end of a pipe
+ * 		  buf - user buffer
+ * 		  nbytes - most bytes to read
+ * OUTPUT: n/a
+ * RETURNS: bytes read, 0 once every writer is gone and the pipe is empty,
+ * 			-1 if a signal is about to kill the process
+ * SIDE EFFECTS: wakes a writer waiting for space
+ */
+int32_t pipe_read (int32_t fd, void* buf, int32_t nbytes) {
+	pipe_t* pipe = &pipes[pcb_ptr_array[cur_pid]->file_desc_array[fd].inode_index];
+	uint32_t count, index, chunk;
+
+	if(!user_range_ok((uint32_t)buf, nbytes))
+		return -1;
+	cli();
+	while(pipe->head == pipe->tail){
+		if(pipe->writers == 0){
+			sti();
+			return 0;
+		}
+		if(signal_fatal_pending(cur_pid)){
+			sti();
+			return -1;
+		}
+		pipe->reader_pid = cur_pid;
+		sched_block();
+		cli();
+	}
+
+	count = pipe->head - pipe->tail;
+	if(count > (uint32_t)nbytes)
+		count = nbytes;
+	// at most two copies, the second one after the buffer wraps
+	index = pipe->tail & (PIPE_SIZE - 1);
+	chunk = PIPE_SIZE - index;
+	if(chunk > count)
+		chunk = count;
+	memcpy(buf, pipe->buf + index, chunk);
+	memcpy((uint8_t*)buf + chunk, pipe->buf, count - chunk);
+	pipe->tail += count;
+
+	if(pipe->writer_pid != -1){
+		sched_wake(pipe->writer_pid);
+		pipe->writer_pid = -1;
+	}
+	sti();
+	return count;
+}
+
+/*
+ * pipe_write
+ * DESCRIPTION: Writes the whole buffer, blocking while the pipe is full. A
+ * 				writer that fills the pipe while the reader waits hands the
+ * 				processor straight to the reader instead of waiting for sched
+ * INPUT: fd - write end of a pipe
+ * 		  buf - user buffer
+ * 		  nbytes - bytes to write
+ * OUTPUT: n/a
+ * RETURNS: nbytes, or what was written before the last reader closed
+ * 			or a signal came, -1 if that was nothing
+ * SIDE EFFECTS: wakes a reader waiting for data
+ */
+int32_t pipe_write (int32_t fd, const void* buf, int32_t nbytes) {
+	pipe_t* pipe = &pipes[pcb_ptr_array[cur_pid]->file_desc_array[fd].inode_index];
+	uint32_t written = 0;
+	uint32_t space, index, chunk;
+	int32_t reader;
+
+	if(!user_range_ok((uint32_t)buf, nbytes))
+		return -1;
+	cli();
+	while(written < (uint32_t)nbytes){
+		if(pipe->readers == 0 || signal_fatal_pending(cur_pid))
+			break;
+
+		space = PIPE_SIZE - (pipe->head - pipe->tail);
+		if(space == 0){
+			pipe->writer_pid = cur_pid;
+			reader = pipe->reader_pid;
+			if(reader != -1){
+				pipe->reader_pid = -1;
+				sched_handoff(reader);
+			}
+			else{
+				sched_block();
+			}
+			cli();
+			continue;
+		}
+
+		if(space > nbytes - written)
+			space = nbytes - written;
+		index = pipe->head & (PIPE_SIZE - 1);
+		chunk = PIPE_SIZE - index;
+		if(chunk > space)
+			chunk = space;
+		memcpy(pipe->buf + index, (uint8_t*)buf + written, chunk);
+		memcpy(pipe->buf, (uint8_t*)buf + written + chunk, space - chunk);
+		pipe->head += space;
+		written += space;
+	}
+
+	if(written > 0 && pipe->reader_pid != -1){
+		sched_wake(pipe->reader_pid);
+		pipe->reader_pid = -1;
+	}
+	sti();
+	return (written == 0) ? -1 : (int32_t)written;
+}
+
+/*
+ * pipe_close
+ * DESCRIPTION: Closes one end of a pipe. The other side is woken so a reader
+ * 				sees end of file and a writer stops writing into nothing
+ * INPUT: fd - either end of a pipe
+ * OUTPUT: n/a
+ * RETURNS: 0
+ * SIDE EFFECTS: frees the pipe when its last end is closed
+ */
+int32_t pipe_close (int32_t fd) {
+	file_desc_t* file = &pcb_ptr_array[cur_pid]->file_desc_array[fd];
+	pipe_t* pipe = &pipes[file->inode_index];
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if(file->file_position == PIPE_READ_END){
+		pipe->readers--;
+		if(pipe->reader_pid == cur_pid)
+			pipe->reader_pid = -1;
+		if(pipe->writer_pid != -1){
+			sched_wake(pipe->writer_pid);
+			pipe->writer_pid = -1;
+		}
+	}
+	else{
+		pipe->writers--;
+		if(pipe->writer_pid == cur_pid)
+			pipe->writer_pid = -1;
+		if(pipe->reader_pid != -1){
+			sched_wake(pipe->reader_pid);
+			pipe->reader_pid = -1;
+		}
+	}
+	if(pipe->readers == 0 && pipe->writers == 0)
+		pipe->in_use = 0;
+	restore_flags(flags);
+
+	file->ops_table = bad_ops;
+	file->inode_index = INVALID_ENTRY;
+	file->file_position = INVALID_ENTRY;
+	file->flags = 0;
+	return 0;
+}
+
+/*
+ * pipe_c (int32_t* fds)
+ * DESCRIPTION: Creates a pipe with both ends in the calling process
+ * INPUT: fds - user array of two, gets the read end then the write end
+ * OUTPUT: n/a
+ * RETURNS: 0 on success, -1 for a bad pointer or no free pipe or descriptors
+ * SIDE EFFECTS: takes two file descriptors
+ */
+int32_t pipe_c (int32_t* fds) {
+	file_desc_t* files = pcb_ptr_array[cur_pid]->file_desc_array;
+	int32_t read_fd, write_fd, pipe;
+
+	if((uint32_t)fds < MB128 || (uint32_t)fds + 2 * sizeof(int32_t) > MB132)
+		return -1;
+
+	for(read_fd = 2; read_fd < MAX_OPEN_FILES && files[read_fd].flags; read_fd++);
+	for(write_fd = read_fd + 1; write_fd < MAX_OPEN_FILES && files[write_fd].flags; write_fd++);
+	if(write_fd >= MAX_OPEN_FILES)
+		return -1;
+	if(-1 == (pipe = pipe_create()))
+		return -1;
+
+	pipe_attach(cur_pid, read_fd, pipe, PIPE_READ_END);
+	pipe_attach(cur_pid, write_fd, pipe, PIPE_WRITE_END);
+	fds[0] = read_fd;
+	fds[1] = write_fd;
+	return 0;
+}
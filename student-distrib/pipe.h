@@ -0,0 +1,28 @@
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "types.h"
+
+/* pipes in use at once, a pipeline from the shell takes one */
+#define MAX_PIPES		4
+/* each pipe buffers one page, a power of two so the indices can run free */
+#define PIPE_SIZE		4096
+/* file_position of a pipe file descriptor says which end it is */
+#define PIPE_READ_END	0
+#define PIPE_WRITE_END	1
+
+/* takes a free pipe with no ends attached, -1 if all are in use */
+extern int32_t pipe_create (void);
+/* gives a pipe back that never had an end attached */
+extern void pipe_free (int32_t pipe);
+/* makes fd of process pid one end of a pipe */
+extern void pipe_attach (int32_t pid, int32_t fd, int32_t pipe, uint32_t end);
+
+extern int32_t pipe_read (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t pipe_write (int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t pipe_close (int32_t fd);
+
+/* creates a pipe in the calling process, fds[0] reads and fds[1] writes */
+extern int32_t pipe_c (int32_t* fds);
+
+#endif /* _PIPE_H */
@@ -0,0 +1,98 @@
+#include "ring.h"
+#include "system_calls.h"
+
+/*
+ * ring_run
+ * DESCRIPTION: Runs one request the way the matching system call would
+ * INPUT: sqe - copy of the request
+ * OUTPUT: n/a
+ * RETURNS: the system call's return value, -1 for a bad request
+ * SIDE EFFECTS: whatever the call does, may block
+ */
+static int32_t ring_run (ring_sqe_t* sqe) {
+	switch(sqe->op){
+		case RING_OP_NOP:
+			return 0;
+		case RING_OP_READ:
+			if(!user_range_ok(sqe->buf, sqe->len))
+				return -1;
+			return read_c(sqe->fd, (void*)sqe->buf, sqe->len);
+		case RING_OP_WRITE:
+			if(!user_range_ok(sqe->buf, sqe->len))
+				return -1;
+			return write_c(sqe->fd, (const void*)sqe->buf, sqe->len);
+		case RING_OP_OPEN:
+			// file names are at most 32 characters, open stops at the terminator
+			if(!user_range_ok(sqe->buf, 1))
+				return -1;
+			return open_c((const uint8_t*)sqe->buf);
+		case RING_OP_CLOSE:
+			return close_c(sqe->fd);
+		default:
+			return -1;
+	}
+}
+
+/*
+ * ring_setup_c (ring_t* ring)
+ * DESCRIPTION: Registers the process's submission and completion rings
+ * INPUT: ring - rings in the program's memory, NULL to drop them
+ * OUTPUT: n/a
+ * RETURNS: 0 on success, -1 if ring isn't in the program's page
+ * SIDE EFFECTS: resets all four indices
+ */
+int32_t ring_setup_c (ring_t* ring) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+
+	if(ring == NULL){
+		pcb->ring = NULL;
+		return 0;
+	}
+	if(!user_range_ok((uint32_t)ring, sizeof(ring_t)))
+		return -1;
+
+	ring->sq_head = 0;
+	ring->sq_tail = 0;
+	ring->cq_head = 0;
+	ring->cq_tail = 0;
+	pcb->ring = ring;
+	return 0;
+}
+
+/*
+ * ring_enter_c (uint32_t to_submit)
+ * DESCRIPTION: Runs queued requests in order and posts their completions
+ * INPUT: to_submit - most requests to run
+ * OUTPUT: n/a
+ * RETURNS: number of requests consumed, -1 if no rings are registered or
+ * 			the program left the indices in an impossible state
+ * SIDE EFFECTS: stops early when the completion ring is full, the rest stay queued
+ */
+int32_t ring_enter_c (uint32_t to_submit) {
+	ring_t* ring = pcb_ptr_array[cur_pid]->ring;
+	ring_sqe_t sqe;
+	ring_cqe_t* cqe;
+	uint32_t head, tail, done;
+
+	if(ring == NULL)
+		return -1;
+
+	head = ring->sq_head;
+	tail = ring->sq_tail;
+	if(tail - head > RING_ENTRIES || ring->cq_tail - ring->cq_head > RING_ENTRIES)
+		return -1;
+
+	for(done = 0; done < to_submit && head != tail; done++){
+		if(ring->cq_tail - ring->cq_head == RING_ENTRIES)
+			break;
+		// copy first, the program may reuse the slot once sq_head moves
+		sqe = ring->sq[head & (RING_ENTRIES - 1)];
+		ring->sq_head = ++head;
+
+		cqe = &ring->cq[ring->cq_tail & (RING_ENTRIES - 1)];
+		cqe->user_data = sqe.user_data;
+		cqe->res = ring_run(&sqe);
+		ring->cq_tail++;
+	}
+	return done;
+}
@@ -0,0 +1,12 @@
+#ifndef _RING_H
+#define _RING_H
+
+#include "types.h"
+#include "ring_data.h"
+
+/* registers the calling process's rings, NULL unregisters them */
+extern int32_t ring_setup_c (ring_t* ring);
+/* runs up to to_submit queued requests, returns how many ran */
+extern int32_t ring_enter_c (uint32_t to_submit);
+
+#endif /* _RING_H */
@@ -0,0 +1,52 @@
+#ifndef _RING_DATA_H
+#define _RING_DATA_H
+
+/*
+    Submission/completion rings for batching system calls. The program owns
+    the memory, registers it with ring_setup and then queues requests by
+    filling sq[sq_tail % RING_ENTRIES] and bumping sq_tail. One ring_enter
+    call runs everything queued, in order, and posts a completion per
+    request at cq[cq_tail % RING_ENTRIES]. The program reads completions
+    from cq_head without another call. Shared with ../syscalls, the
+    includer provides the stdint types.
+
+    Requests run synchronously inside ring_enter, so a read that blocks
+    (terminal, rtc) holds up the ones queued behind it.
+*/
+
+// power of two so the free running indices can be masked
+#define RING_ENTRIES 32
+
+#define RING_OP_NOP     0
+#define RING_OP_READ    1
+#define RING_OP_WRITE   2
+#define RING_OP_OPEN    3
+#define RING_OP_CLOSE   4
+
+typedef struct ring_sqe{
+    uint32_t op;
+    int32_t fd;
+    // buffer for read and write, file name for open
+    uint32_t buf;
+    int32_t len;
+    // copied to the completion so the program can match them up
+    uint32_t user_data;
+} ring_sqe_t;
+
+typedef struct ring_cqe{
+    uint32_t user_data;
+    // what the matching system call would have returned
+    int32_t res;
+} ring_cqe_t;
+
+typedef struct ring{
+    // sq_tail and cq_head are written by the program, the heads by the kernel
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    ring_sqe_t sq[RING_ENTRIES];
+    ring_cqe_t cq[RING_ENTRIES];
+} ring_t;
+
+#endif /* _RING_DATA_H */
@@ -2,6 +2,8 @@
 #include "lib.h"
 #include "i8259.h"
 #include "system_calls.h"
+#include "sched.h"
+#include "vdso.h"
 
 /* 
  * rtc_init(void)
@@ -13,38 +15,27 @@
  *               changes reg B on RTC to enable periodic interrupts
  */
 
-volatile int interrupt_occurred[MAX_PCBS];
 int opened[MAX_PCBS];
 int frequencies[MAX_PCBS];
-volatile int counts[MAX_PCBS];
+// sched_clock() time of each process's next virtual interrupt
+uint32_t rtc_deadline[MAX_PCBS];
 
 
 /* void rtc_init();
  * Inputs: void
  * Return Value: none
- * Function: Init rtc */
+ * Function: Init rtc. The virtual RTC runs off PIT one-shot deadlines, so the
+ *           periodic interrupt is left off and the chip never wakes an idle CPU */
 void rtc_init(){
-    uint8_t register_b;
     int i;
     for( i = 0; i< MAX_PCBS; i ++){     
-        interrupt_occurred[i] = 0;
         opened[i] = 0;
         frequencies[i] = DEFAULT_FREQUENCY;
-        counts[i] = MAX_FREQUENCY/DEFAULT_FREQUENCY;
+        rtc_deadline[i] = 0;
     }
 
-    //select Reg B and read
-    outb(REG_B, RTC_PORT);
-    register_b = inb(CMOS_PORT);
-
-    //select Reg B and turn on
-    outb(REG_B, RTC_PORT);
-    outb(((register_b)|(TURN_ON_BIT)), CMOS_PORT);
-
     enable_irq(IRQ_SLAVE);      // enable the slave to interrupt master since it is responsible for RTC
     enable_irq(IRQ_RTC);        // enable the RTC interrupt line
-
-    write_frequency(MAX_FREQUENCY);
 }
 
 
@@ -56,28 +47,67 @@ void rtc_init(){
 void rtc_interrupt_handler(){
     //read from reg c so another interrupt can occur
     uint8_t junk;
-    int i;
 
 	outb(REG_C,RTC_PORT);
 	junk = inb(CMOS_PORT);
 
-    for(i = 0; i < MAX_PCBS; i++){
-        counts[i]--;
-        if( counts[i] <= 0){
-            //reset count
-            counts[i] = MAX_FREQUENCY/frequencies[i];
-            //set flag for interrupt occuring
-            interrupt_occurred[i] = 1;
-            
-        }
-        
-    }
-
 
     //renable PIC for RTC
 	send_eoi(IRQ_RTC);
 
-    
+    //keep the time of day in the shared page fresh
+    vdso_set_time_of_day(rtc_time_of_day());
+}
+
+/* uint8_t cmos_read(uint8_t reg);
+ * Inputs: reg - register to read, with the NMI disable bit
+ * Return Value: register value
+ * Function: Selects a CMOS register and reads it */
+static uint8_t cmos_read(uint8_t reg){
+    outb(reg, RTC_PORT);
+    return inb(CMOS_PORT);
+}
+
+/* uint8_t bcd_to_binary(uint8_t val);
+ * Inputs: val - two BCD digits
+ * Return Value: the value in binary */
+static uint8_t bcd_to_binary(uint8_t val){
+    return (val & 0x0F) + (val >> 4) * 10;
+}
+
+/* uint32_t rtc_time_of_day();
+ * Inputs: void
+ * Return Value: seconds since midnight
+ * Function: Reads the RTC clock, waiting out an update in progress so the
+ *           fields belong to the same second. Handles BCD and 12 hour mode */
+uint32_t rtc_time_of_day(){
+    uint8_t sec, min, hour, reg_b;
+    uint8_t pm;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    while(cmos_read(REG_A) & UPDATE_IN_PROGRESS);
+    sec = cmos_read(REG_SECONDS);
+    min = cmos_read(REG_MINUTES);
+    hour = cmos_read(REG_HOURS);
+    reg_b = cmos_read(REG_B);
+    restore_flags(flags);
+
+    pm = hour & HOUR_PM;
+    hour &= ~HOUR_PM;
+    if(!(reg_b & BINARY_MODE)){
+        sec = bcd_to_binary(sec);
+        min = bcd_to_binary(min);
+        hour = bcd_to_binary(hour);
+    }
+    // 12 hour mode runs 12, 1, ..., 11
+    if(!(reg_b & HOUR_24)){
+        hour %= 12;
+        if(pm){
+            hour += 12;
+        }
+    }
+    return hour * SECONDS_PER_HOUR + min * SECONDS_PER_MINUTE + sec;
 }
 
 /* void rtc_read (int32_t fd, void* buf, int32_t nbytes);
@@ -87,19 +117,28 @@ void rtc_interrupt_handler(){
  * Return Value: 0 for success
  *              -1 for failure
  * Return Value: none
- * Side Effects: returns zero after interrupt occurs
+ * Side Effects: returns zero after the next virtual interrupt
  */
 int32_t rtc_read (int32_t fd, void* buf, int32_t nbytes){
+    uint32_t period;
+    uint32_t deadline;
+
     //check if rtc is opened
     if(opened[cur_pid] != 1){
         return -1;
     }
 
-    //wait for interrupt
-    while(interrupt_occurred[cur_pid] != 1);
-    
-    //reset flag
-    interrupt_occurred[cur_pid] = 0;
+    //sleep until the virtual interrupt is due, the PIT one-shot wakes us
+    cli();
+    deadline = rtc_deadline[cur_pid];
+    sched_sleep_until(deadline);
+
+    //next interrupt is one period later, or one period from now if we fell behind
+    period = PIT_FREQ/frequencies[cur_pid];
+    rtc_deadline[cur_pid] = deadline + period;
+    if((int32_t)(sched_clock() - rtc_deadline[cur_pid]) >= 0){
+        rtc_deadline[cur_pid] = sched_clock() + period;
+    }
 
     return 0;
 }
@@ -150,7 +189,6 @@ int32_t rtc_write (int32_t fd, const void* buf, int32_t nbytes){
 int32_t rtc_open (const uint8_t* filename){
 
     opened[cur_pid] = 1;
-    interrupt_occurred[cur_pid] = 0;
     set_frequency(DEFAULT_FREQUENCY);
     return 0;
 }
@@ -205,7 +243,7 @@ int32_t set_frequency(uint32_t frequency){
  
     frequencies[cur_pid] = frequency;
 
-    counts[cur_pid] = MAX_FREQUENCY/frequency;
+    rtc_deadline[cur_pid] = sched_clock() + PIT_FREQ/frequency;
 
     return 0;
 }
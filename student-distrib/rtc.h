@@ -17,6 +17,21 @@
 #define REG_B       0x8B
 #define REG_C       0x8C
 
+/* time of day registers, also with NMI disabled */
+#define REG_SECONDS 0x80
+#define REG_MINUTES 0x82
+#define REG_HOURS   0x84
+
+/* reg A: time registers are being updated, don't read them */
+#define UPDATE_IN_PROGRESS 0x80
+/* reg B: values are binary instead of BCD, hours are 24 hour */
+#define BINARY_MODE 0x04
+#define HOUR_24     0x02
+/* hours register: PM in 12 hour mode */
+#define HOUR_PM     0x80
+#define SECONDS_PER_MINUTE 60
+#define SECONDS_PER_HOUR   3600
+
 /* which bit in reg B corosponds to periodic interrupts*/
 #define TURN_ON_BIT 0x40
 
@@ -35,6 +50,9 @@ extern void rtc_init();
 /*interrupt handler for rtc*/
 extern void rtc_interrupt_handler();
 
+/*reads the RTC time of day, in seconds since midnight*/
+extern uint32_t rtc_time_of_day();
+
 /*driver function to edit frequency per process*/
 int32_t set_frequency(uint32_t frequency);
 
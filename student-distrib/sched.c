@@ -1,98 +1,583 @@
 #include "sched.h"
+#include "vdso.h"
+
+// stack the idle task runs on, it never touches user space so no page is needed
+static uint8_t idle_stack[IDLE_STACK_SIZE] __attribute__((aligned (4)));
+// sched_clock() when the idle task last took over
+static uint32_t idle_start;
+
+// TSC value at calibration and PIT cycles per TSC cycle scaled by 2^32
+static uint64_t tsc_base;
+static uint32_t tsc_mult = 0;
+// sched_clock() when the running process got the CPU and when the next boost is due
+static uint32_t run_start;
+static uint32_t boost_deadline;
+// set by sched_yield so sched gives the CPU away even with slice left
+static uint8_t yield_pending = 0;
+// switched out of by detached processes that halt, never resumed
+static context_t exit_context;
+// deadline the one-shot is counting down to, pit_armed is 0 while it is stopped
+static uint32_t pit_deadline;
+static uint8_t pit_armed = 0;
+
+volatile uint8_t idle_active = 0;
+// the first switch to the idle task starts idle_task on the top of its stack
+context_t idle_context = {0, 0, 0, 0, (uint32_t)(idle_stack + IDLE_STACK_SIZE - aligned_1), (uint32_t)idle_task, 0};
+volatile uint32_t idle_time = 0;
+volatile uint32_t timer_interrupts = 0;
+
+static int32_t next_runnable(int32_t pid);
+static void sched_boost_all();
+static void sched_charge(uint32_t now);
+static void sched_run(int32_t next_pid, context_t* prev_context, uint32_t now);
+static void timer_program(uint32_t now);
+static int32_t sched_direct(int32_t pid);
 
 /* void PIT_init();
  * Inputs: void
  * Return Value: none
- * Function: Init PIT */
+ * Function: Init PIT. Calibrates the TSC against one 10 ms count, then leaves
+ *           channel 0 in one-shot mode with no count loaded until sched arms it */
 void PIT_init(){
-    //set channel 0 to mode 3, sending lowbyte/highbyte
-    outb(COMMAND, CMD_REG);
-    //send lowbyte of fequency to channel 0
-    outb(FREQ_LOW_BYTE, CH0_PORT);
-    //send highbyte of frequency to channel 0
-    outb(FREQ_HIGH_BYTE, CH0_PORT);
+    uint32_t start, cycles, mult, rem;
+
+    //set channel 0 to mode 0, sending lowbyte/highbyte
+    outb(ONESHOT_COMMAND, CMD_REG);
+    //send lowbyte of calibration count to channel 0
+    outb(CALIBRATE_COUNT & 0xFF, CH0_PORT);
+    //send highbyte of calibration count to channel 0
+    outb(CALIBRATE_COUNT >> 8, CH0_PORT);
+    start = rdtsc();
+    // spin until OUT goes high at the end of the count
+    do{
+        outb(READBACK_CH0, CMD_REG);
+    }while(!(inb(CH0_PORT) & PIT_OUT_HIGH));
+    cycles = rdtsc() - start;
+
+    // mult = CALIBRATE_COUNT * 2^32 / cycles, fits in 32 bits since the TSC runs faster than the PIT
+    asm volatile("divl %2"
+                 : "=a"(mult), "=d"(rem)
+                 : "rm"(cycles), "a"(0), "d"(CALIBRATE_COUNT)
+                );
+    tsc_mult = mult;
+    tsc_base = rdtsc64();
+    vdso_set_clock(tsc_base, tsc_mult);
+
+    // rewriting the mode stops the counter, nothing fires until timer_program loads a count
+    outb(ONESHOT_COMMAND, CMD_REG);
     enable_irq(IRQ_PIT);
     return;
 }
 
+/* uint32_t sched_clock(void);
+ * Inputs: void
+ * Return Value: PIT cycles since PIT_init
+ * Function: Converts the TSC to PIT cycles with the multiplier from calibration.
+ *           Only 64-bit multiplies and shifts, which need no libgcc helpers */
+uint32_t sched_clock(){
+    uint64_t tsc = rdtsc64() - tsc_base;
+    return (uint32_t)((tsc >> 32) * tsc_mult + (((tsc & 0xFFFFFFFF) * tsc_mult) >> 32));
+}
+
 /* void PIT_interrupt_handler(void);
  * Inputs: void
  * Return Value: none
- * Function: Runs interrupt for PIT */
+ * Function: Runs interrupt for PIT. The one-shot fired because a deadline passed:
+ *           wakes sleepers that are due, sends alarms and lets sched end the time slice */
 void PIT_interrupt_handler(){
+    int32_t i;
+    uint32_t now;
+
     send_eoi(IRQ_PIT);
+    timer_interrupts++;
+    // the count ran out, the one-shot is idle until timer_program loads another
+    pit_armed = 0;
+
+    now = sched_clock();
+    vdso_tick(now, timer_interrupts);
+    for(i = 0; i < MAX_PCBS; i++){
+        if(pcb_ptr_array[i] != NULL && pcb_ptr_array[i]->sleeping
+            && (int32_t)(now - pcb_ptr_array[i]->sleep_deadline) >= 0){
+            pcb_ptr_array[i]->sleeping = 0;
+            pcb_ptr_array[i]->state = TASK_RUNNABLE;
+        }
+    }
+    signal_alarms(now);
+    vidbuf_tick(now);
     sched();
     return;
 }
 
+/* void timer_program(uint32_t now);
+ * Inputs: now - current sched_clock()
+ * Return Value: none
+ * Function: Arms the one-shot for the earliest pending deadline: the end of the
+ *           running process's slice (only if someone else wants the CPU), the
+ *           wakeup of a sleeper or an alarm. With no deadline the PIT is left stopped.
+ *           Port writes are slow, more so under virtualization, so the PIT is only
+ *           touched when that deadline differs from the one it is counting to */
+static void timer_program(uint32_t now){
+    int32_t i;
+    int32_t delta;
+    uint32_t deadline = 0;
+    uint8_t armed = 0;
+    uint8_t waiting = 0;
+
+    for(i = 0; i < MAX_PCBS; i++){
+        if(pcb_ptr_array[i] == NULL){
+            continue;
+        }
+        // only processes with an ALARM handler need their alarm on time
+        if(pcb_ptr_array[i]->sig_handlers[SIG_ALARM] != 0){
+            if(!armed || (int32_t)(pcb_ptr_array[i]->alarm_deadline - deadline) < 0){
+                deadline = pcb_ptr_array[i]->alarm_deadline;
+                armed = 1;
+            }
+        }
+        if(pcb_ptr_array[i]->sleeping){
+            if(!armed || (int32_t)(pcb_ptr_array[i]->sleep_deadline - deadline) < 0){
+                deadline = pcb_ptr_array[i]->sleep_deadline;
+                armed = 1;
+            }
+        }
+        else if(i != cur_pid && !pcb_ptr_array[i]->isParent && pcb_ptr_array[i]->state == TASK_RUNNABLE){
+            waiting = 1;
+        }
+    }
+
+    // timed presents of vidmap back buffers
+    if(vidbuf_clients != 0){
+        if(!armed || (int32_t)(vidbuf_deadline - deadline) < 0){
+            deadline = vidbuf_deadline;
+            armed = 1;
+        }
+    }
+
+    // time slice end only matters if another process is waiting for the CPU
+    if(waiting && !idle_active){
+        if(!armed || (int32_t)(run_start + pcb_ptr_array[cur_pid]->slice_left - deadline) < 0){
+            deadline = run_start + pcb_ptr_array[cur_pid]->slice_left;
+            armed = 1;
+        }
+    }
+
+    if(armed == pit_armed && (!armed || deadline == pit_deadline)){
+        return;
+    }
+    pit_armed = armed;
+    pit_deadline = deadline;
+
+    // rewriting the mode stops any count in progress
+    outb(ONESHOT_COMMAND, CMD_REG);
+    if(!armed){
+        return;
+    }
+
+    delta = (int32_t)(deadline - now);
+    if(delta < PIT_MIN_COUNT){
+        delta = PIT_MIN_COUNT;
+    }
+    // deadlines further out than one count just take an extra interrupt on the way
+    if(delta > PIT_MAX_COUNT){
+        delta = PIT_MAX_COUNT;
+    }
+    outb(delta & 0xFF, CH0_PORT);
+    outb(delta >> 8, CH0_PORT);
+}
+
+/* void sched_charge(uint32_t now);
+ * Inputs: now - current sched_clock()
+ * Return Value: none
+ * Function: Charges the time since run_start to the running process. A process that
+ *           used its whole slice without blocking is CPU bound and sinks a level */
+static void sched_charge(uint32_t now){
+    pcb_t* cur_pcb = pcb_ptr_array[cur_pid];
+    uint32_t ran = now - run_start;
+
+    run_start = now;
+    if(idle_active || cur_pcb == NULL){
+        return;
+    }
+    if(ran < cur_pcb->slice_left){
+        cur_pcb->slice_left -= ran;
+        return;
+    }
+    cur_pcb->slice_left = 0;
+    if(cur_pcb->level < MLFQ_LEVELS - 1){
+        cur_pcb->level++;
+    }
+}
+
+/* void sched_boost_all(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Moves every process back to the top level so CPU bound processes
+ *           that sank to the bottom still get to run */
+static void sched_boost_all(){
+    int32_t i;
+    for(i = 0; i < MAX_PCBS; i++){
+        if(pcb_ptr_array[i] != NULL){
+            pcb_ptr_array[i]->level = 0;
+        }
+    }
+}
+
+/* int32_t next_runnable(int32_t pid);
+ * Inputs: pid - process to start the round-robin scan after
+ * Return Value: pid of the next process that can run, -1 if there is none
+ * Function: Picks the runnable process on the highest level. Scanning starts after
+ *           pid and only a strictly better level replaces the pick, so processes on
+ *           the same level take turns and pid itself is only kept if it is the best.
+ *           Skips empty entries, parents waiting on a child and blocked processes */
+static int32_t next_runnable(int32_t pid){
+    int32_t i;
+    int32_t next_pid = pid;
+    int32_t best_pid = -1;
+
+    for(i = 0; i < MAX_PCBS; i++){
+        next_pid = (next_pid + 1) % MAX_PCBS;
+        if(pcb_ptr_array[next_pid] != NULL && !pcb_ptr_array[next_pid]->isParent
+            && pcb_ptr_array[next_pid]->state == TASK_RUNNABLE){
+            if(best_pid == -1 || pcb_ptr_array[next_pid]->level < pcb_ptr_array[best_pid]->level){
+                best_pid = next_pid;
+            }
+        }
+    }
+    return best_pid;
+}
+
 
 /* void sched(void);
  * Inputs: void
  * Return Value: none
- * Function: Allows each process to run periodically. Triggered by PIT interrupt */
+ * Function: Picks the process to run. Called from the PIT one-shot when a deadline
+ *           passes, from the keyboard on input and by processes that block.
+ *           Switches to the idle task when no process is runnable, and always
+ *           leaves the one-shot armed for the next deadline */
 void sched(){
     int next_pid;
+    uint32_t now;
+    uint8_t yielding;
+    context_t* prev_context;
     cli();
 
-    // sanity check in case interrupt occurs before first execute    
+    // sanity check in case interrupt occurs before first execute
     if(cur_pid < 0 || cur_pid >= MAX_PCBS){
         return;
     }
 
-    next_pid = cur_pid;
+    yielding = yield_pending;
+    yield_pending = 0;
 
-    do{
-        next_pid = (next_pid + 1) % MAX_PCBS; 
-    }while(pcb_ptr_array[next_pid] == NULL || pcb_ptr_array[next_pid]->isParent);
+    now = sched_clock();
+    sched_charge(now);
+    if((int32_t)(now - boost_deadline) >= 0){
+        sched_boost_all();
+        boost_deadline = now + MLFQ_BOOST_COUNT;
+    }
+
+    next_pid = next_runnable(cur_pid);
 
-    // sanity check
-    // should not happen since 3 shells should be running at any given time
-    if(cur_pid == next_pid){
-        //printf("ERROR: Only one PCB initialized.");
+    // nothing to switch to, keep running whatever we are on
+    if(next_pid == -1 && idle_active){
+        timer_program(now);
         return;
     }
+    if(!idle_active){
+        pcb_t* cur_pcb = pcb_ptr_array[cur_pid];
+        // current process is still the best choice, give it a fresh slice if it ran out
+        if(next_pid == cur_pid){
+            if(cur_pcb->slice_left == 0){
+                cur_pcb->slice_left = MLFQ_SLICE(cur_pcb->level);
+            }
+            timer_program(now);
+            return;
+        }
+        // keep the current process until its slice ends unless a higher level is waiting
+        if(next_pid != -1 && cur_pcb->state == TASK_RUNNABLE && !cur_pcb->isParent && !yielding
+            && cur_pcb->slice_left > 0 && pcb_ptr_array[next_pid]->level >= cur_pcb->level){
+            timer_program(now);
+            return;
+        }
+    }
 
-    // update current process with the current ebp and esp
-    pcb_t* cur_pcb = pcb_ptr_array[cur_pid];
-    asm volatile(   "movl %%esp, %0 	\n"
-                    "movl %%ebp, %1 	\n"
-                    : "=r"(cur_pcb->user_esp), "=g"(cur_pcb->user_ebp)
-                    :: "memory"
-                );    
+    // context of the task we are leaving
+    if(idle_active){
+        prev_context = &idle_context;
+    }
+    else{
+        prev_context = &pcb_ptr_array[cur_pid]->context;
+    }
+    sched_run(next_pid, prev_context, now);
+}
+
+/* void sched_run(int32_t next_pid, context_t* prev_context, uint32_t now);
+ * Inputs: next_pid - process to run, -1 for the idle task
+ *         prev_context - where the task we are leaving is saved
+ *         now - current sched_clock()
+ * Return Value: none
+ * Function: Switches to next_pid, its page and kernel stack, and arms the one-shot.
+ *           Returns once something switches back to prev_context */
+static void sched_run(int32_t next_pid, context_t* prev_context, uint32_t now){
+    // every process is blocked, let the idle task halt the CPU
+    if(next_pid == -1){
+        idle_active = 1;
+        idle_start = now;
+        timer_program(now);
+        switch_to(prev_context, &idle_context, 0);
+        return;
+    }
+    if(idle_active){
+        sched_leave_idle();
+    }
 
-    
     // switch the current page at address 128MB
     switch_task_page(next_pid);
 
     // update current process id
     cur_pid = next_pid;
 
-    if(pcb_ptr_array[next_pid]->vidmap_ptr != NULL){
-        update_vidmap();
+    if(pcb_ptr_array[next_pid]->slice_left == 0){
+        pcb_ptr_array[next_pid]->slice_left = MLFQ_SLICE(pcb_ptr_array[next_pid]->level);
     }
-    
+    timer_program(now);
+
 
     // update kernel stack
     tss.ss0 = KERNEL_DS;
     tss.esp0 = pcb_ptr_array[cur_pid]->kernel_esp;
-    
-    // get pointer to the pcb that we are switching to
-    pcb_t* next_pcb = pcb_ptr_array[cur_pid];
 
-    // must reenable before switch since return doesnt execute till next switch
+    // returns once something switches back to the task we are leaving
+    switch_to(prev_context, &pcb_ptr_array[cur_pid]->context, 0);
+    return;
+}
+
+/* int32_t sched_direct(int32_t pid);
+ * Inputs: pid - runnable process to switch to
+ * Return Value: 0 once something switched back to us, -1 if pid can't run and
+ *               nothing happened
+ * Function: The directed switch behind sched_handoff and sched_yield_to. Charges
+ *           the current process and switches straight to pid without scanning for
+ *           the best process. The one-shot keeps its deadline, which at worst ends
+ *           pid's slice early, unless nothing is armed and the current process
+ *           still wants the CPU. Called with interrupts disabled */
+static int32_t sched_direct(int32_t pid){
+    pcb_t* next;
+    context_t* prev_context;
+    uint32_t now;
+    uint8_t waiting;
+
+    if(idle_active || cur_pid < 0 || cur_pid >= MAX_PCBS || pid < 0 || pid >= MAX_PCBS
+        || pid == cur_pid || (next = pcb_ptr_array[pid]) == NULL
+        || next->isParent || next->state != TASK_RUNNABLE){
+        return -1;
+    }
+
+    now = sched_clock();
+    sched_charge(now);
+    prev_context = &pcb_ptr_array[cur_pid]->context;
+    if(next->slice_left == 0){
+        next->slice_left = MLFQ_SLICE(next->level);
+    }
+    waiting = pcb_ptr_array[cur_pid]->state == TASK_RUNNABLE;
+
+    switch_task_page(pid);
+    cur_pid = pid;
+    // a yielding process has to get the CPU back when pid's slice ends
+    if(!pit_armed && waiting){
+        timer_program(now);
+    }
+    tss.ss0 = KERNEL_DS;
+    tss.esp0 = next->kernel_esp;
+    switch_to(prev_context, &next->context, 0);
+    return 0;
+}
+
+/* void sched_handoff(int32_t pid);
+ * Inputs: pid - blocked process to run instead of the current one
+ * Return Value: none
+ * Function: Blocks the current process like sched_block, but wakes pid and switches
+ *           straight to it whatever its level, so a producer that has to wait for its
+ *           consumer doesn't pay for a trip through the scheduler. Called with
+ *           interrupts disabled, returns with them enabled once sched_wake has run */
+void sched_handoff(int32_t pid){
+    pcb_ptr_array[cur_pid]->state = TASK_BLOCKED;
+    sched_wake(pid);
+    if(sched_direct(pid) == -1){
+        sched();
+    }
     sti();
+}
 
-    // load the next pcb's ebp/esp
-    asm volatile(   "movl %0, %%esp     \n"
-                    "movl %1, %%ebp     \n"
-                    :
-                    : "a"(next_pcb->user_esp), "b"(next_pcb->user_ebp)
-                    : "esp", "ebp"
-                );
+/* void sched_yield_to(int32_t pid);
+ * Inputs: pid - process to run next
+ * Return Value: none
+ * Function: Like sched_yield, but the CPU goes straight to pid whatever its level.
+ *           The current process stays runnable. Called with interrupts disabled,
+ *           returns with them enabled */
+void sched_yield_to(int32_t pid){
+    if(sched_direct(pid) == -1){
+        yield_pending = 1;
+        sched();
+    }
+    sti();
+}
 
-    // return should breakdown the sched on the switched process stack
-    return;
+/* void sched_exit(void);
+ * Inputs: void
+ * Return Value: none, does not return
+ * Function: Leaves a detached process that halt already freed. Nobody waits for
+ *           it, so the next runnable process or the idle task takes over. cur_pid
+ *           has to keep naming a live process, interrupts look up its terminal.
+ *           Called with interrupts disabled */
+void sched_exit(){
+    uint32_t now = sched_clock();
+    int32_t i;
+
+    // halt leaves cur_pid on the parent, any process will do if that is gone too
+    for(i = 0; i < MAX_PCBS && pcb_ptr_array[cur_pid] == NULL; i++){
+        if(pcb_ptr_array[i] != NULL){
+            cur_pid = i;
+        }
+    }
+    run_start = now;
+    sched_run(next_runnable(cur_pid), &exit_context, now);
+}
+
+/* void sched_block(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Marks the current process blocked and gives up the CPU. Called with
+ *           interrupts disabled so a wakeup can not slip in before the process is
+ *           marked, returns with interrupts enabled once sched_wake has run */
+void sched_block(){
+    pcb_ptr_array[cur_pid]->state = TASK_BLOCKED;
+    sched();
+    sti();
+}
+
+/* void sched_yield(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Gives the rest of the time slice to the next runnable process.
+ *           Keeps the slice and level, so yielding is not treated as blocking.
+ *           Returns right away through the switch_to fast path if nothing else can run */
+void sched_yield(){
+    cli();
+    yield_pending = 1;
+    sched();
+    sti();
+}
+
+/* void sched_sleep_until(uint32_t deadline);
+ * Inputs: deadline - sched_clock() value to sleep until
+ * Return Value: none
+ * Function: Blocks the current process until the PIT handler sees the deadline
+ *           pass. Called with interrupts disabled, returns with them enabled */
+void sched_sleep_until(uint32_t deadline){
+    pcb_t* cur_pcb = pcb_ptr_array[cur_pid];
+
+    if((int32_t)(sched_clock() - deadline) >= 0){
+        sti();
+        return;
+    }
+    cur_pcb->sleep_deadline = deadline;
+    cur_pcb->sleeping = 1;
+    // other wakeups (keyboard) can make us runnable early, just go back to sleep
+    while(cur_pcb->sleeping){
+        sched_block();
+        cli();
+    }
+    sti();
+}
+
+/* void sched_wake(int32_t pid);
+ * Inputs: pid - process to wake
+ * Return Value: none
+ * Function: Makes a blocked process runnable, it is picked up on the next sched */
+void sched_wake(int32_t pid){
+    if(pid < 0 || pid >= MAX_PCBS || pcb_ptr_array[pid] == NULL){
+        return;
+    }
+    pcb_ptr_array[pid]->state = TASK_RUNNABLE;
 }
 
+/* void sched_wake_term(int32_t term_id);
+ * Inputs: term_id - terminal whose readers should wake
+ * Return Value: none
+ * Function: Wakes the processes blocked in terminal_read on a terminal, used when a
+ *           line is finished. Processes blocked on anything else are left alone.
+ *           Readers are interactive so they are boosted to level 0 with a full slice */
+void sched_wake_term(int32_t term_id){
+    int32_t i;
+    for(i = 0; i < MAX_PCBS; i++){
+        if(pcb_ptr_array[i] != NULL && pcb_ptr_array[i]->term_id == term_id
+            && pcb_ptr_array[i]->term_reading && pcb_ptr_array[i]->state == TASK_BLOCKED){
+            pcb_ptr_array[i]->level = 0;
+            pcb_ptr_array[i]->slice_left = MLFQ_SLICE(0);
+            pcb_ptr_array[i]->wake_tsc = rdtsc();
+            pcb_ptr_array[i]->state = TASK_RUNNABLE;
+        }
+    }
+}
 
+/* void sched_wake_latency(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Called by a reader once it runs again after sched_wake_term. Publishes
+ *           how long that took in the vDSO page, where wakebench picks it up */
+void sched_wake_latency(){
+    pcb_t* cur_pcb = pcb_ptr_array[cur_pid];
+    uint32_t latency;
+    uint32_t flags;
 
+    if(cur_pcb->wake_tsc == 0){
+        return;
+    }
+    latency = rdtsc() - cur_pcb->wake_tsc;
+    cur_pcb->wake_tsc = 0;
+
+    cli_and_save(flags);
+    vdso_set_wake_latency(latency);
+    restore_flags(flags);
+}
+
+/* void sched_reset_slice(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: execute and halt change cur_pid without going through sched, so the
+ *           new process starts its slice here and the one-shot is re-armed */
+void sched_reset_slice(){
+    uint32_t now = sched_clock();
+    run_start = now;
+    timer_program(now);
+}
+
+/* void sched_leave_idle(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Ends an idle period, adds it to idle_time and publishes that to user space */
+void sched_leave_idle(){
+    idle_time += sched_clock() - idle_start;
+    idle_active = 0;
+    vdso_set_idle(idle_time);
+}
+
+/* void idle_task(void);
+ * Inputs: void
+ * Return Value: none
+ * Function: Runs when every process is blocked. Halts until the next interrupt and
+ *           hands the CPU back as soon as an interrupt made a process runnable */
+void idle_task(){
+    while(1){
+        cli();
+        if(next_runnable(cur_pid) != -1){
+            sched();
+        }
+        else{
+            // sti only takes effect after hlt starts, so no wakeup is missed in between
+            irq_off_end();
+            asm volatile("sti; hlt");
+        }
+    }
+}
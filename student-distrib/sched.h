@@ -6,19 +6,74 @@
 #include "paging.h"
 
 // frequencies in Hz
-#define PIT_FREQ 1193182 
-// 50 Hz gives cycles 20 ms
-#define FREQ 50
-#define COUNT (PIT_FREQ/FREQ)
-#define FREQ_HIGH_BYTE (COUNT >> 0x8)
-#define FREQ_LOW_BYTE  (COUNT & 0xFF)
-// Channel0 [7:6] = 00, Access Mode Lobyte/Hibyte [5:4] 11, Mode 3 [3:1] 111, binary mode [0] 0
-#define COMMAND 0x36 
+#define PIT_FREQ 1193182
+// Channel0 [7:6] = 00, Access Mode Lobyte/Hibyte [5:4] 11, Mode 0 [3:1] 000, binary mode [0] 0
+// mode 0 interrupts once when the count runs out, then waits for a new count
+#define ONESHOT_COMMAND 0x30
+// read-back [7:6] = 11, don't latch count [5] 1, latch status [4] 0, channel 0 [1] 1
+#define READBACK_CH0 0xE2
+// bit 7 of the read-back status is the OUT pin, high once the count ran out
+#define PIT_OUT_HIGH 0x80
 #define CMD_REG 0x43
 #define CH0_PORT 0x40
+// shortest and longest one-shot we program, in PIT cycles (~84us and ~55ms)
+#define PIT_MIN_COUNT 100
+#define PIT_MAX_COUNT 0xFFFF
+// TSC is calibrated against 10 ms of PIT counting
+#define CALIBRATE_COUNT (PIT_FREQ/100)
+
+// base time slice is 10 ms, in PIT cycles
+#define SLICE_HZ 100
+#define SLICE_COUNT (PIT_FREQ/SLICE_HZ)
+
+// multi-level feedback queue, level 0 is the highest priority
+#define MLFQ_LEVELS 3
+// time slice in PIT cycles doubles each level: 10ms, 20ms, 40ms
+#define MLFQ_SLICE(level) (SLICE_COUNT << (level))
+// every second all processes go back to level 0 so nothing starves
+#define MLFQ_BOOST_COUNT PIT_FREQ
+
+// kernel stack for the idle task, same size as a process kernel stack
+#define IDLE_STACK_SIZE KB8
+
+// set while the idle task owns the CPU, cur_pid still names the last process that ran
+extern volatile uint8_t idle_active;
+// saved context of the idle task while it is switched out
+extern context_t idle_context;
+// idle-time accounting in PIT cycles, compare against sched_clock()
+extern volatile uint32_t idle_time;
+// number of timer interrupts taken, an idle system should take almost none
+extern volatile uint32_t timer_interrupts;
 
 extern void PIT_init();
 extern void PIT_interrupt_handler();
+// time since boot in PIT cycles, read from the calibrated TSC. wraps after about an hour
+// so compare times with (int32_t)(a - b)
+uint32_t sched_clock();
 void sched();
+// blocks the current process until sched_wake, call with interrupts disabled
+void sched_block();
+// gives the CPU to the next runnable process without blocking
+void sched_yield();
+// blocks the current process until sched_clock() reaches deadline, call with interrupts disabled
+void sched_sleep_until(uint32_t deadline);
+// blocks the current process and runs pid next, call with interrupts disabled
+void sched_handoff(int32_t pid);
+// runs pid next but keeps the current process runnable, call with interrupts disabled
+void sched_yield_to(int32_t pid);
+// switches away from a detached process that halted, call with interrupts disabled
+void sched_exit();
+// makes a blocked process runnable again
+void sched_wake(int32_t pid);
+// wakes the processes blocked in terminal_read on the given terminal, boosted to level 0
+void sched_wake_term(int32_t term_id);
+// records how long the current process took to run after sched_wake_term
+void sched_wake_latency();
+// starts a fresh time slice for cur_pid after execute/halt changed it, call with interrupts disabled
+void sched_reset_slice();
+// leaves the idle task for a process started from an interrupt, call with interrupts disabled
+void sched_leave_idle();
+// body of the idle task, halts the CPU until something is runnable
+void idle_task();
 
 #endif
@@ -0,0 +1,239 @@
+#include "shm.h"
+#include "system_calls.h"
+
+/* one shared memory segment, frames index shm_frames */
+typedef struct shm_segment{
+	uint32_t key;
+	uint32_t pages;
+	uint32_t refs;
+	/* last process to create or look it up, frees it at halt if nothing attached */
+	int32_t creator;
+	uint8_t in_use;
+	uint8_t frames[SHM_MAX_PAGES];
+} shm_segment_t;
+
+/* segments live in kernel memory, the kernel can clear them without mapping anything */
+static uint8_t shm_frames[SHM_FRAMES][SHM_PAGE_SIZE] __attribute__((aligned (SHM_PAGE_SIZE)));
+static uint8_t frame_used[SHM_FRAMES];
+static shm_segment_t segments[SHM_MAX_SEGMENTS];
+
+/* protects segments and frame_used */
+static spinlock_t shm_lock = SPINLOCK_INIT("shm");
+
+/*
+ * shm_create_c (uint32_t key, uint32_t size)
+ * DESCRIPTION: Looks up the segment for a key, making a zeroed one if there is none
+ * INPUT: key - name the cooperating programs agree on
+ * 		  size - bytes needed, rounded up to whole pages
+ * OUTPUT: n/a
+ * RETURNS: segment id, -1 for a bad size, an existing segment that is too
+ * 			small or no free segment or pages
+ * SIDE EFFECTS: takes pages from the shared memory pool, a segment
+ * 				 nothing attaches is freed when the caller halts
+ */
+int32_t shm_create_c (uint32_t key, uint32_t size) {
+	uint32_t pages = (size + SHM_PAGE_SIZE - 1) / SHM_PAGE_SIZE;
+	uint32_t flags, i, free_frames;
+	int32_t id = -1;
+
+	if(size == 0 || pages > SHM_MAX_PAGES)
+		return -1;
+
+	flags = spin_lock_irqsave(&shm_lock);
+	for(i = 0; i < SHM_MAX_SEGMENTS; i++){
+		if(segments[i].in_use && segments[i].key == key){
+			if(segments[i].refs == 0)
+				segments[i].creator = cur_pid;
+			spin_unlock_irqrestore(&shm_lock, flags);
+			return (segments[i].pages >= pages) ? (int32_t)i : -1;
+		}
+		if(!segments[i].in_use && id == -1)
+			id = i;
+	}
+
+	for(free_frames = 0, i = 0; i < SHM_FRAMES; i++){
+		if(!frame_used[i])
+			free_frames++;
+	}
+	if(id == -1 || free_frames < pages){
+		spin_unlock_irqrestore(&shm_lock, flags);
+		return -1;
+	}
+
+	segments[id].in_use = 1;
+	segments[id].key = key;
+	segments[id].pages = pages;
+	segments[id].refs = 0;
+	segments[id].creator = cur_pid;
+	for(free_frames = 0, i = 0; free_frames < pages; i++){
+		if(!frame_used[i]){
+			frame_used[i] = 1;
+			memset(shm_frames[i], 0, SHM_PAGE_SIZE);
+			segments[id].frames[free_frames++] = i;
+		}
+	}
+	spin_unlock_irqrestore(&shm_lock, flags);
+	return id;
+}
+
+/*
+ * shm_overlaps
+ * DESCRIPTION: Checks a range of the window against the caller's attachments
+ * INPUT: addr - start of the range
+ * 		  pages - its length in pages
+ * OUTPUT: n/a
+ * RETURNS: 1 if some attached segment is in the way, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+static int32_t shm_overlaps (uint32_t addr, uint32_t pages) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	uint32_t end = addr + pages * SHM_PAGE_SIZE;
+	int32_t i;
+
+	for(i = 0; i < SHM_MAX_ATTACH; i++){
+		if(pcb->shm_ids[i] != -1 && addr < pcb->shm_addrs[i] + segments[pcb->shm_ids[i]].pages * SHM_PAGE_SIZE
+			&& pcb->shm_addrs[i] < end)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * shm_attach_c (int32_t id, void* addr)
+ * DESCRIPTION: Maps a segment into the calling process
+ * INPUT: id - from shm_create
+ * 		  addr - page aligned address in the window, NULL to take the
+ * 				 lowest free spot
+ * OUTPUT: n/a
+ * RETURNS: the address the segment is at, -1 for a bad id or address,
+ * 			an overlap or too many attachments
+ * SIDE EFFECTS: adds a reference to the segment
+ */
+int32_t shm_attach_c (int32_t id, void* addr) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	uint32_t frames[SHM_MAX_PAGES];
+	uint32_t start = (uint32_t)addr;
+	uint32_t flags, pages, i;
+	int32_t slot;
+
+	if(id < 0 || id >= SHM_MAX_SEGMENTS)
+		return -1;
+	for(slot = 0; slot < SHM_MAX_ATTACH && pcb->shm_ids[slot] != -1; slot++);
+	if(slot == SHM_MAX_ATTACH)
+		return -1;
+
+	flags = spin_lock_irqsave(&shm_lock);
+	if(!segments[id].in_use){
+		spin_unlock_irqrestore(&shm_lock, flags);
+		return -1;
+	}
+	pages = segments[id].pages;
+
+	if(addr == NULL){
+		for(start = SHM_ADDR; start + pages * SHM_PAGE_SIZE <= SHM_ADDR + SHM_WINDOW; start += SHM_PAGE_SIZE){
+			if(!shm_overlaps(start, pages))
+				break;
+		}
+	}
+	if((start & (SHM_PAGE_SIZE - 1)) || start < SHM_ADDR
+		|| start + pages * SHM_PAGE_SIZE > SHM_ADDR + SHM_WINDOW || shm_overlaps(start, pages)){
+		spin_unlock_irqrestore(&shm_lock, flags);
+		return -1;
+	}
+
+	segments[id].refs++;
+	for(i = 0; i < pages; i++)
+		frames[i] = (uint32_t)shm_frames[segments[id].frames[i]];
+	spin_unlock_irqrestore(&shm_lock, flags);
+
+	pcb->shm_ids[slot] = id;
+	pcb->shm_addrs[slot] = start;
+	map_shm_pages(cur_pid, start, frames, pages);
+	return (int32_t)start;
+}
+
+/*
+ * shm_free
+ * DESCRIPTION: Gives a segment's pages back to the pool, call with shm_lock held
+ * INPUT: seg - segment with no attachments
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: the segment id can be reused
+ */
+static void shm_free (shm_segment_t* seg) {
+	uint32_t i;
+
+	for(i = 0; i < seg->pages; i++)
+		frame_used[seg->frames[i]] = 0;
+	seg->in_use = 0;
+}
+
+/*
+ * shm_release
+ * DESCRIPTION: Unmaps one attachment of the current process
+ * INPUT: slot - index into the pcb's attachments
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: frees the segment and its pages with the last reference
+ */
+static void shm_release (int32_t slot) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	shm_segment_t* seg = &segments[pcb->shm_ids[slot]];
+	uint32_t flags;
+
+	unmap_shm_pages(cur_pid, pcb->shm_addrs[slot], seg->pages);
+	pcb->shm_ids[slot] = -1;
+	pcb->shm_addrs[slot] = 0;
+
+	flags = spin_lock_irqsave(&shm_lock);
+	if(--seg->refs == 0)
+		shm_free(seg);
+	spin_unlock_irqrestore(&shm_lock, flags);
+}
+
+/*
+ * shm_detach_c (void* addr)
+ * DESCRIPTION: Unmaps the segment attached at addr
+ * INPUT: addr - address shm_attach returned
+ * OUTPUT: n/a
+ * RETURNS: 0 on success, -1 if nothing is attached there
+ * SIDE EFFECTS: drops the segment's reference
+ */
+int32_t shm_detach_c (void* addr) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	int32_t slot;
+
+	for(slot = 0; slot < SHM_MAX_ATTACH; slot++){
+		if(pcb->shm_ids[slot] != -1 && pcb->shm_addrs[slot] == (uint32_t)addr){
+			shm_release(slot);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * shm_detach_all
+ * DESCRIPTION: Drops every attachment of the current process and frees
+ * 				the segments it created that nothing ever attached
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: may free segments
+ */
+void shm_detach_all (void) {
+	int32_t slot;
+	uint32_t flags, i;
+
+	for(slot = 0; slot < SHM_MAX_ATTACH; slot++){
+		if(pcb_ptr_array[cur_pid]->shm_ids[slot] != -1)
+			shm_release(slot);
+	}
+
+	flags = spin_lock_irqsave(&shm_lock);
+	for(i = 0; i < SHM_MAX_SEGMENTS; i++){
+		if(segments[i].in_use && segments[i].refs == 0 && segments[i].creator == cur_pid)
+			shm_free(&segments[i]);
+	}
+	spin_unlock_irqrestore(&shm_lock, flags);
+}
@@ -0,0 +1,24 @@
+#ifndef _SHM_H
+#define _SHM_H
+
+#include "types.h"
+#include "shm_data.h"
+
+/* segments in the system at once */
+#define SHM_MAX_SEGMENTS	8
+/* pages the segments can use between them */
+#define SHM_FRAMES			64
+/* segments one process can have attached */
+#define SHM_MAX_ATTACH		4
+
+/* id of the segment for key, made with at least size bytes if it doesn't exist */
+extern int32_t shm_create_c (uint32_t key, uint32_t size);
+/* maps a segment at addr, or at the first free spot for NULL, returns the address */
+extern int32_t shm_attach_c (int32_t id, void* addr);
+/* unmaps the segment attached at addr */
+extern int32_t shm_detach_c (void* addr);
+/* detaches everything the current process has attached and frees what it
+   created that nothing attached, used by halt */
+extern void shm_detach_all (void);
+
+#endif /* _SHM_H */
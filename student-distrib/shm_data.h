@@ -0,0 +1,22 @@
+#ifndef _SHM_DATA_H
+#define _SHM_DATA_H
+
+/*
+    Shared memory segments. shm_create finds or makes the segment for a
+    key, shm_attach maps its pages into the caller at a page aligned
+    address inside the window below, and shm_detach unmaps them again.
+    Every process that attaches a segment sees the same physical pages,
+    so nothing is copied. A segment is freed when its last attachment
+    goes away, halting detaches everything. One that is never attached
+    is freed when the process that created it halts. Shared with
+    ../syscalls.
+*/
+
+// page directory entry 35, just above the vdso page, one window per process
+#define SHM_ADDR        0x8C00000
+#define SHM_WINDOW      0x400000
+#define SHM_PAGE_SIZE   4096
+// largest segment, in pages
+#define SHM_MAX_PAGES   16
+
+#endif /* _SHM_DATA_H */
@@ -0,0 +1,239 @@
+#include "signal.h"
+#include "system_calls.h"
+#include "sched.h"
+#include "vdso.h"
+
+// user selectors and the eflags bits a program may set itself
+#define USER_EFLAGS_MASK 0x00000CD5
+#define ALARM_PERIOD (PIT_FREQ * ALARM_SECONDS)
+
+volatile uint32_t signal_work = 0;
+
+/* int32_t signal_kills(int32_t signum);
+ * Inputs: signum - signal number
+ * Return Value: 1 if the default action kills the process, 0 if it ignores the signal
+ * Function: DIV_ZERO, SEGFAULT and INTERRUPT kill, ALARM and USER1 are ignored */
+static int32_t signal_kills(int32_t signum){
+    return signum == SIG_DIV_ZERO || signum == SIG_SEGFAULT || signum == SIG_INTERRUPT;
+}
+
+/* void signal_update_work(pcb_t* pcb);
+ * Inputs: pcb - process to check
+ * Return Value: none
+ * Function: Sets the process's signal_work bit if it has something to deliver
+ *           or a sigreturn to finish, clears it otherwise */
+static void signal_update_work(pcb_t* pcb){
+    if(pcb->sig_restore || (pcb->sig_pending && !pcb->sig_masked)){
+        signal_work |= 1 << pcb->pid;
+    }
+    else{
+        signal_work &= ~(1 << pcb->pid);
+    }
+}
+
+/* void send_signal(int32_t pid, int32_t signum);
+ * Inputs: pid - process to signal
+ *         signum - signal number
+ * Return Value: none
+ * Function: Marks the signal pending, it is delivered the next time the process
+ *           returns to user space. A process blocked on a read is woken if the
+ *           signal will kill it, so Ctrl+C works on a program waiting for input */
+void send_signal(int32_t pid, int32_t signum){
+    uint32_t flags;
+    pcb_t* pcb;
+
+    if(pid < 0 || pid >= MAX_PCBS || signum < 0 || signum >= NUM_SIGNALS){
+        return;
+    }
+    flags = spin_lock_irqsave(&pcb_lock);
+    pcb = pcb_ptr_array[pid];
+    if(pcb != NULL){
+        pcb->sig_pending |= 1 << signum;
+        signal_update_work(pcb);
+        if(signal_fatal_pending(pid) && pcb->state == TASK_BLOCKED && !pcb->sleeping){
+            sched_wake(pid);
+        }
+    }
+    spin_unlock_irqrestore(&pcb_lock, flags);
+}
+
+/* int32_t signal_fatal_pending(int32_t pid);
+ * Inputs: pid - process to check
+ * Return Value: nonzero if a pending signal has no handler and kills the process */
+int32_t signal_fatal_pending(int32_t pid){
+    int32_t signum;
+    pcb_t* pcb = pcb_ptr_array[pid];
+
+    for(signum = 0; signum < NUM_SIGNALS; signum++){
+        if((pcb->sig_pending & (1 << signum)) && signal_kills(signum)
+            && pcb->sig_handlers[signum] == 0){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* void signal_fault(int32_t signum);
+ * Inputs: signum - SIG_DIV_ZERO or SIG_SEGFAULT
+ * Return Value: none
+ * Function: Called by the exception handlers for faults in user mode. A fault
+ *           inside a handler can't be handled again, so it kills the process,
+ *           as does a fault with no handler installed */
+void signal_fault(int32_t signum){
+    pcb_t* pcb = pcb_ptr_array[cur_pid];
+
+    if(pcb->sig_masked || pcb->sig_handlers[signum] == 0){
+        pcb->error_flag = 1;
+        halt_c(USER_PROGRAM_CRASH);
+    }
+    send_signal(cur_pid, signum);
+}
+
+/* void signal_interrupt_term(int32_t term);
+ * Inputs: term - terminal Ctrl+C was pressed on
+ * Return Value: none
+ * Function: The foreground processes are the ones on the terminal that have no
+ *           child, more than one when a pipeline runs */
+void signal_interrupt_term(int32_t term){
+    int32_t i;
+
+    for(i = 0; i < MAX_PCBS; i++){
+        if(pcb_ptr_array[i] != NULL && pcb_ptr_array[i]->term_id == term
+            && !pcb_ptr_array[i]->isParent){
+            send_signal(i, SIG_INTERRUPT);
+        }
+    }
+}
+
+/* void signal_alarms(uint32_t now);
+ * Inputs: now - sched_clock()
+ * Return Value: none
+ * Function: Only processes with an ALARM handler have alarms armed, the default
+ *           action ignores the signal so nobody else needs the timer */
+void signal_alarms(uint32_t now){
+    int32_t i;
+
+    for(i = 0; i < MAX_PCBS; i++){
+        if(pcb_ptr_array[i] != NULL && pcb_ptr_array[i]->sig_handlers[SIG_ALARM] != 0
+            && (int32_t)(now - pcb_ptr_array[i]->alarm_deadline) >= 0){
+            pcb_ptr_array[i]->alarm_deadline = now + ALARM_PERIOD;
+            send_signal(i, SIG_ALARM);
+        }
+    }
+}
+
+/* void signal_restore(hw_context_t* ctx);
+ * Inputs: ctx - context going back to user space
+ * Return Value: none
+ * Function: Finishes a sigreturn. The trampoline's int 0x80 came in with esp just
+ *           above the signal number, where the saved context starts. Selectors are
+ *           forced back to user ones and only harmless eflags bits are taken, so a
+ *           handler can't raise its privilege through the saved context */
+static void signal_restore(hw_context_t* ctx){
+    pcb_t* pcb = pcb_ptr_array[cur_pid];
+    hw_context_t* saved = (hw_context_t*)ctx->esp;
+
+    pcb->sig_restore = 0;
+    pcb->sig_masked = 0;
+    if(!user_range_ok((uint32_t)saved, sizeof(hw_context_t))){
+        pcb->error_flag = 1;
+        halt_c(USER_PROGRAM_CRASH);
+    }
+    memcpy(ctx, saved, sizeof(hw_context_t));
+    ctx->cs = USER_CS;
+    ctx->ss = USER_DS;
+    ctx->ds = USER_DS;
+    ctx->es = USER_DS;
+    ctx->fs = USER_DS;
+    ctx->eflags = (ctx->eflags & USER_EFLAGS_MASK) | EFLAGS_IF;
+}
+
+/* void do_signal(hw_context_t* ctx);
+ * Inputs: ctx - context on the kernel stack that ret_from_intr restores
+ * Return Value: none
+ * Function: Runs on the way back to user space when signal_work is set. Default
+ *           actions are taken right here. For a handler the context is copied to
+ *           the user stack with the signal number and a return address into the
+ *           vdso trampoline below it, and ctx is pointed at the handler. Signals
+ *           stay masked until the handler's sigreturn */
+void do_signal(hw_context_t* ctx){
+    pcb_t* pcb = pcb_ptr_array[cur_pid];
+    int32_t signum;
+    uint32_t* frame;
+
+    // system calls get here right after a plain cli on their way out
+    irq_off_begin(EFLAGS_IF, "do_signal");
+    if(pcb->sig_restore){
+        signal_restore(ctx);
+    }
+
+    while(pcb->sig_pending && !pcb->sig_masked){
+        for(signum = 0; !(pcb->sig_pending & (1 << signum)); signum++);
+        pcb->sig_pending &= ~(1 << signum);
+
+        if(pcb->sig_handlers[signum] == 0){
+            if(signal_kills(signum)){
+                pcb->error_flag = 1;
+                halt_c(USER_PROGRAM_CRASH);
+            }
+            continue;
+        }
+
+        // return address, signal number, then the context
+        frame = (uint32_t*)(ctx->esp - sizeof(hw_context_t)) - 2;
+        if(!user_range_ok((uint32_t)frame, sizeof(hw_context_t) + 2 * sizeof(uint32_t))){
+            pcb->error_flag = 1;
+            halt_c(USER_PROGRAM_CRASH);
+        }
+        memcpy(frame + 2, ctx, sizeof(hw_context_t));
+        frame[1] = signum;
+        frame[0] = VDSO_ADDR + VDSO_SIGRETURN;
+
+        ctx->esp = (uint32_t)frame;
+        ctx->eip = pcb->sig_handlers[signum];
+        pcb->sig_masked = 1;
+    }
+    signal_update_work(pcb);
+}
+
+/*
+ * set_handler_c (int32_t signum, void* handler_address)
+ * DESCRIPTION: Installs a user handler for a signal
+ * INPUT: signum - signal number
+ *           handler_address - user function taking the signal number, NULL for the default action
+ * OUTPUT: n/a
+ * RETURNS: 0 on success, -1 for a bad signal number or handler address
+ * SIDE EFFECTS: installing an ALARM handler starts the process's alarm
+ */
+int32_t set_handler_c (int32_t signum, void* handler_address) {
+    pcb_t* pcb = pcb_ptr_array[cur_pid];
+
+    if(signum < 0 || signum >= NUM_SIGNALS)
+        return -1;
+    if(handler_address != NULL && !user_range_ok((uint32_t)handler_address, 1))
+        return -1;
+
+    pcb->sig_handlers[signum] = (uint32_t)handler_address;
+    if(signum == SIG_ALARM){
+        pcb->alarm_deadline = sched_clock() + ALARM_PERIOD;
+    }
+    return 0;
+}
+
+/*
+ * sigreturn_c (void)
+ * DESCRIPTION: Called by the trampoline when a signal handler returns
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: nothing the program sees, the saved context replaces every register
+ * SIDE EFFECTS: do_signal restores the context on the way out and unmasks signals
+ */
+int32_t sigreturn_c (void) {
+    pcb_t* pcb = pcb_ptr_array[cur_pid];
+
+    if(!pcb->sig_masked)
+        return -1;
+    pcb->sig_restore = 1;
+    signal_update_work(pcb);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef _SIGNAL_H
+#define _SIGNAL_H
+
+// signal numbers, the same as enum signums in ece391syscall.h
+#define SIG_DIV_ZERO    0
+#define SIG_SEGFAULT    1
+#define SIG_INTERRUPT   2
+#define SIG_ALARM       3
+#define SIG_USER1       4
+#define NUM_SIGNALS     5
+
+// processes with an alarm handler get SIG_ALARM this often
+#define ALARM_SECONDS   10
+
+// byte offsets into hw_context_t for the assembly entry paths
+#define HW_EBX      0
+#define HW_EAX      24
+#define HW_IRQNUM   40
+#define HW_ERRCODE  44
+#define HW_EIP      48
+#define HW_CS       52
+#define HW_EFLAGS   56
+#define HW_ESP      60
+#define HW_SS       64
+// requested privilege level bits of a selector
+#define RPL_MASK    3
+
+#ifndef ASM
+
+#include "types.h"
+
+/*
+    Registers of a user program as it entered the kernel, built on the
+    kernel stack by the interrupt, exception and system call paths and
+    restored from there by ret_from_intr. Signal delivery copies it to
+    the user stack right above the signal number, in this order, so a
+    handler can find and change the registers its program returns with.
+    The segment registers and irqnum/errcode take a full word each
+*/
+typedef struct hw_context{
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
+    uint32_t eax;
+    uint32_t ds;
+    uint32_t es;
+    uint32_t fs;
+    uint32_t irqnum;
+    uint32_t errcode;
+    // pushed by the processor (or faked by sysenter_handler)
+    uint32_t eip;
+    uint32_t cs;
+    uint32_t eflags;
+    uint32_t esp;
+    uint32_t ss;
+} hw_context_t;
+
+// bit per pid with a signal to deliver or a sigreturn to finish, checked on
+// the way back to user space
+extern volatile uint32_t signal_work;
+
+// marks signum pending for pid and wakes it if the signal would kill it
+extern void send_signal(int32_t pid, int32_t signum);
+// nonzero if pid has a pending signal that will kill it, blocking reads give up
+extern int32_t signal_fatal_pending(int32_t pid);
+// signal for a fault the current process caused in user mode
+extern void signal_fault(int32_t signum);
+// sends SIG_INTERRUPT to the processes in the foreground of a terminal
+extern void signal_interrupt_term(int32_t term);
+// sends SIG_ALARM to processes whose alarm is due and rearms them, call with interrupts disabled
+extern void signal_alarms(uint32_t now);
+// delivers pending signals or finishes a sigreturn before ctx goes back to user space
+extern void do_signal(hw_context_t* ctx);
+
+extern int32_t set_handler_c (int32_t signum, void* handler_address);
+extern int32_t sigreturn_c (void);
+
+// return path shared by interrupts, exceptions and system calls, expects a hw_context_t on the stack
+extern void ret_from_intr();
+// user code copied into the vdso page, calls sigreturn when a handler returns
+extern uint8_t sigreturn_trampoline[];
+extern uint8_t sigreturn_trampoline_end[];
+
+#endif /* ASM */
+#endif /* _SIGNAL_H */
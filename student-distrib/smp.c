@@ -0,0 +1,298 @@
+#include "smp.h"
+#include "sched.h"
+#include "paging.h"
+#include "system_calls_asm.h"
+
+/* MP floating pointer structure, found by its "_MP_" signature */
+typedef struct mp_float{
+    uint8_t signature[4];
+    uint32_t config;
+    uint8_t length;
+    uint8_t spec_rev;
+    uint8_t checksum;
+    uint8_t features[5];
+} __attribute__((packed)) mp_float_t;
+
+/* MP configuration table header, entries follow it */
+typedef struct mp_config{
+    uint8_t signature[4];
+    uint16_t length;
+    uint8_t spec_rev;
+    uint8_t checksum;
+    uint8_t oem_id[8];
+    uint8_t product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_size;
+    uint16_t entry_count;
+    uint32_t lapic_addr;
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+} __attribute__((packed)) mp_config_t;
+
+/* MP configuration table processor entry */
+typedef struct mp_proc{
+    uint8_t type;
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} __attribute__((packed)) mp_proc_t;
+
+cpu_t cpus[MAX_CPUS];
+uint32_t num_cpus = 1;
+
+static uint32_t lapic_base = LAPIC_DEFAULT_BASE;
+// set once the local APIC is mapped, only the BSP runs before that
+static uint8_t lapic_mapped = 0;
+// read by the trampoline and ap_main for the processor being started
+volatile uint32_t ap_stack_top;
+static cpu_t* volatile ap_boot_cpu;
+
+/* uint8_t mp_checksum(uint8_t* addr, uint32_t len);
+ * Inputs: addr - start of the structure
+ *         len - length in bytes
+ * Return Value: sum of the bytes, 0 for a valid MP structure
+ * Function: MP structures are valid when all of their bytes add up to 0 */
+static uint8_t mp_checksum(uint8_t* addr, uint32_t len){
+    uint8_t sum = 0;
+    uint32_t i;
+    for(i = 0; i < len; i++){
+        sum += addr[i];
+    }
+    return sum;
+}
+
+/* mp_float_t* mp_scan(uint32_t start, uint32_t len);
+ * Inputs: start - physical address to start at
+ *         len - bytes to search
+ * Return Value: floating pointer structure or NULL
+ * Function: Searches a range for the floating pointer on 16 byte boundaries */
+static mp_float_t* mp_scan(uint32_t start, uint32_t len){
+    uint32_t addr;
+    for(addr = start; addr + sizeof(mp_float_t) <= start + len; addr += MP_FLOAT_ALIGN){
+        mp_float_t* mp = (mp_float_t*)addr;
+        if(!strncmp((int8_t*)mp->signature, (int8_t*)"_MP_", 4)
+            && mp_checksum((uint8_t*)mp, sizeof(mp_float_t)) == 0){
+            return mp;
+        }
+    }
+    return NULL;
+}
+
+/* uint32_t lapic_read(uint32_t reg);
+ * Inputs: reg - register offset
+ * Return Value: register value
+ * Function: Reads a local APIC register */
+static uint32_t lapic_read(uint32_t reg){
+    return *(volatile uint32_t*)(lapic_base + reg);
+}
+
+/* void lapic_write(uint32_t reg, uint32_t val);
+ * Inputs: reg - register offset
+ *         val - value to write
+ * Return Value: none
+ * Function: Writes a local APIC register */
+static void lapic_write(uint32_t reg, uint32_t val){
+    *(volatile uint32_t*)(lapic_base + reg) = val;
+}
+
+/* void lapic_ipi(uint8_t apic_id, uint32_t icr);
+ * Inputs: apic_id - destination processor
+ *         icr - low half of the interrupt command
+ * Return Value: none
+ * Function: Sends an IPI and waits until the APIC has delivered it */
+static void lapic_ipi(uint8_t apic_id, uint32_t icr){
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << LAPIC_ID_SHIFT);
+    lapic_write(LAPIC_ICR_LOW, icr);
+    while(lapic_read(LAPIC_ICR_LOW) & ICR_PENDING);
+}
+
+/* void smp_delay(uint32_t cycles);
+ * Inputs: cycles - PIT cycles to wait
+ * Return Value: none
+ * Function: Busy waits on sched_clock, only used while booting processors */
+static void smp_delay(uint32_t cycles){
+    uint32_t start = sched_clock();
+    while(sched_clock() - start < cycles);
+}
+
+/* void smp_detect();
+ * Inputs: void
+ * Return Value: none
+ * Function: Looks for the MP tables where the spec says they can be and fills in
+ *           cpus[] with the enabled processors, BSP first. Without MP tables the
+ *           system is treated as a single processor. Reads low physical memory
+ *           directly so it has to run before paging is turned on */
+void smp_detect(){
+    mp_float_t* mp;
+    mp_config_t* config;
+    uint8_t* entry;
+    uint32_t i;
+    uint32_t ebda = (uint32_t)(*(uint16_t*)EBDA_SEG_PTR) << 4;
+
+    num_cpus = 1;
+    cpus[0].id = 0;
+    cpus[0].apic_id = 0;
+    cpus[0].online = 1;
+
+    mp = NULL;
+    if(ebda != 0){
+        mp = mp_scan(ebda, ONE_KB_BYTES);
+    }
+    if(mp == NULL){
+        mp = mp_scan(BASE_MEM_LAST_KB, ONE_KB_BYTES);
+    }
+    if(mp == NULL){
+        mp = mp_scan(BIOS_ROM_START, BIOS_ROM_END - BIOS_ROM_START);
+    }
+    // no table or only a default configuration, stay on one processor
+    if(mp == NULL || mp->config == 0){
+        return;
+    }
+
+    config = (mp_config_t*)mp->config;
+    if(strncmp((int8_t*)config->signature, (int8_t*)"PCMP", 4)
+        || mp_checksum((uint8_t*)config, config->length) != 0){
+        return;
+    }
+    lapic_base = config->lapic_addr;
+
+    // slot 0 is always the BSP, application processors follow in table order
+    entry = (uint8_t*)(config + 1);
+    for(i = 0; i < config->entry_count; i++){
+        if(*entry == MP_ENTRY_PROC){
+            mp_proc_t* proc = (mp_proc_t*)entry;
+            if(proc->flags & MP_PROC_BSP){
+                cpus[0].apic_id = proc->apic_id;
+            }
+            else if((proc->flags & MP_PROC_ENABLED) && num_cpus < MAX_CPUS){
+                cpus[num_cpus].id = num_cpus;
+                cpus[num_cpus].apic_id = proc->apic_id;
+                num_cpus++;
+            }
+            entry += MP_PROC_SIZE;
+        }
+        else{
+            entry += MP_ENTRY_SIZE;
+        }
+    }
+}
+
+/* void cpu_load_gdt(cpu_t* cpu);
+ * Inputs: cpu - processor being set up
+ * Return Value: none
+ * Function: Gives a processor its own copy of the kernel GDT with the TSS entry
+ *           pointing at its own TSS, then loads the GDT, LDT and task register */
+static void cpu_load_gdt(cpu_t* cpu){
+    seg_desc_t* tss_desc = &cpu->gdt[TSS_GDT_INDEX];
+
+    memcpy(cpu->gdt, gdt, sizeof(cpu->gdt));
+    tss_desc->type = TSS_AVAILABLE;
+    SET_TSS_PARAMS((*tss_desc), &cpu->tss, tss_size);
+
+    memset(&cpu->tss, 0, sizeof(tss_t));
+    cpu->tss.ldt_segment_selector = KERNEL_LDT;
+    cpu->tss.ss0 = KERNEL_DS;
+    cpu->tss.esp0 = (uint32_t)(cpu->stack + KB8 - aligned_1);
+
+    cpu->gdt_desc.size = sizeof(cpu->gdt) - 1;
+    cpu->gdt_desc.addr = (uint32_t)cpu->gdt;
+    asm volatile("lgdt (%0)" : : "r"(&cpu->gdt_desc.size) : "memory");
+    lldt(KERNEL_LDT);
+    ltr(KERNEL_TSS);
+}
+
+/* void smp_init();
+ * Inputs: void
+ * Return Value: none
+ * Function: Starts the application processors one at a time with INIT-SIPI-SIPI
+ *           and waits for each to check in. Maps the local APIC and the trampoline
+ *           page, so it runs after paging, and uses sched_clock for the delays */
+void smp_init(){
+    uint32_t i;
+    uint32_t start;
+    uint32_t online = 1;
+
+    if(num_cpus == 1){
+        return;
+    }
+
+    map_mmio(lapic_base);
+    lapic_mapped = 1;
+    identity_map_page(AP_TRAMPOLINE);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE);
+    memcpy((void*)AP_TRAMPOLINE, ap_trampoline, ap_trampoline_end - ap_trampoline);
+
+    for(i = 1; i < num_cpus; i++){
+        cpu_t* cpu = &cpus[i];
+
+        ap_boot_cpu = cpu;
+        ap_stack_top = (uint32_t)(cpu->stack + KB8 - aligned_1);
+
+        lapic_ipi(cpu->apic_id, ICR_INIT);
+        smp_delay(INIT_DELAY);
+        lapic_ipi(cpu->apic_id, ICR_STARTUP | (AP_TRAMPOLINE >> PAGE_OFFSET));
+        smp_delay(SIPI_DELAY);
+        // second SIPI in case the first was missed, ignored by a processor that already started
+        if(!cpu->online){
+            lapic_ipi(cpu->apic_id, ICR_STARTUP | (AP_TRAMPOLINE >> PAGE_OFFSET));
+        }
+
+        start = sched_clock();
+        while(!cpu->online && sched_clock() - start < AP_BOOT_TIMEOUT);
+        if(!cpu->online){
+            printf("CPU %d (APIC %d) did not start\n", cpu->id, cpu->apic_id);
+        }
+        else{
+            online++;
+        }
+    }
+    printf("%d of %d processors online, processes run on CPU 0\n", online, num_cpus);
+}
+
+/* void ap_main();
+ * Inputs: void
+ * Return Value: none
+ * Function: Runs on an application processor once the trampoline has it in
+ *           protected mode with paging. Loads its own GDT and TSS, enables its
+ *           local APIC and checks in. The processor is then parked with interrupts
+ *           off. Processes only run on the BSP: cur_pid, the page directory with
+ *           the user page and the scheduler state are all still global */
+void ap_main(){
+    cpu_t* cpu = ap_boot_cpu;
+
+    cpu_load_gdt(cpu);
+    // without sysenter, sysenter_init would printf and take term_lock from here
+    if(cpuid_features() & CPUID_SEP){
+        sysenter_init(&cpu->tss);
+    }
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE);
+    cpu->online = 1;
+
+    while(1){
+        asm volatile("cli; hlt");
+    }
+}
+
+/* cpu_t* this_cpu();
+ * Inputs: void
+ * Return Value: the processor the caller runs on
+ * Function: Looks up the local APIC id in cpus[] */
+cpu_t* this_cpu(){
+    uint32_t i;
+    uint8_t apic_id;
+
+    if(num_cpus == 1 || !lapic_mapped){
+        return &cpus[0];
+    }
+    apic_id = lapic_read(LAPIC_ID) >> LAPIC_ID_SHIFT;
+    for(i = 0; i < num_cpus; i++){
+        if(cpus[i].apic_id == apic_id){
+            return &cpus[i];
+        }
+    }
+    return &cpus[0];
+}
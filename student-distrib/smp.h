@@ -0,0 +1,79 @@
+#ifndef _SMP_H
+#define _SMP_H
+
+#include "types.h"
+#include "x86_desc.h"
+#include "system_calls.h"
+#include "smp_asm.h"
+
+// most processors we bring up, enough for qemu -smp 4
+#define MAX_CPUS 4
+// entries in the kernel GDT, each processor gets its own copy
+#define GDT_ENTRIES 8
+#define TSS_GDT_INDEX (KERNEL_TSS >> 3)
+// TSS descriptor type for an available (not busy) 32-bit TSS
+#define TSS_AVAILABLE 0x9
+
+// where the MP floating pointer can live: first KB of the EBDA, last KB of base
+// memory or the BIOS ROM
+#define EBDA_SEG_PTR 0x40E
+#define BASE_MEM_LAST_KB 0x9FC00
+#define BIOS_ROM_START 0xF0000
+#define BIOS_ROM_END 0x100000
+#define ONE_KB_BYTES 1024
+#define MP_FLOAT_ALIGN 16
+// MP configuration table entry types, processors are 20 bytes and the rest 8
+#define MP_ENTRY_PROC 0
+#define MP_PROC_SIZE 20
+#define MP_ENTRY_SIZE 8
+#define MP_PROC_ENABLED 0x01
+#define MP_PROC_BSP 0x02
+
+// local APIC registers, as byte offsets from the base
+#define LAPIC_DEFAULT_BASE 0xFEE00000
+#define LAPIC_ID 0x20
+#define LAPIC_SVR 0xF0
+#define LAPIC_ICR_LOW 0x300
+#define LAPIC_ICR_HIGH 0x310
+#define LAPIC_ID_SHIFT 24
+// software enable with spurious vector 0xFF
+#define LAPIC_SVR_ENABLE 0x1FF
+// INIT and STARTUP IPIs, level assert; delivery status bit is set while sending
+#define ICR_INIT 0x4500
+#define ICR_STARTUP 0x4600
+#define ICR_PENDING 0x1000
+
+// INIT-SIPI-SIPI delays from the MP spec, and how long an AP gets to check in, in PIT cycles
+#define INIT_DELAY (PIT_FREQ/100)
+#define SIPI_DELAY (PIT_FREQ/5000)
+#define AP_BOOT_TIMEOUT (PIT_FREQ/10)
+
+/*
+    Per-processor state. Every application processor has its own GDT (so its
+    TSS descriptor can be busy independently), TSS and boot stack; the BSP
+    keeps the boot GDT and tss. Nothing here schedules: cur_pid, tss.esp0, the
+    user page directory and the run queue are the BSP's alone
+*/
+typedef struct cpu{
+    uint8_t id;
+    uint8_t apic_id;
+    volatile uint8_t online;
+    x86_desc_t gdt_desc;
+    seg_desc_t gdt[GDT_ENTRIES] __attribute__((aligned (8)));
+    tss_t tss;
+    uint8_t stack[KB8] __attribute__((aligned (16)));
+} cpu_t;
+
+extern cpu_t cpus[MAX_CPUS];
+extern uint32_t num_cpus;
+
+// finds the processors in the MP tables, must run before paging is enabled
+void smp_detect();
+// starts every application processor found by smp_detect, needs paging and the PIT
+void smp_init();
+// processor the caller is running on
+cpu_t* this_cpu();
+// C entry point for application processors
+void ap_main();
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _SMP_ASM_H
+#define _SMP_ASM_H
+
+// physical page the application processors start in, the SIPI vector is its page number
+#define AP_TRAMPOLINE 0x8000
+
+// control register bits the trampoline sets
+#define CR0_PE  0x00000001
+#define CR0_PG  0x80000000
+#define CR4_PSE 0x00000010
+
+#ifndef ASM
+
+#include "types.h"
+
+// real mode code copied to AP_TRAMPOLINE, runs each application processor into ap_main
+extern uint8_t ap_trampoline[];
+extern uint8_t ap_trampoline_end[];
+
+#endif
+#endif
@@ -0,0 +1,69 @@
+#include "softirq.h"
+#include "lib.h"
+
+volatile uint32_t softirq_pending = 0;
+volatile uint32_t softirq_active = 0;
+
+static void (*softirq_handlers[NUM_SOFTIRQS])(void);
+
+/*
+ * open_softirq
+ * DESCRIPTION: Installs the handler of a softirq
+ * INPUT: nr - softirq number
+ *        handler - function to run when it is raised
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: none
+ */
+void open_softirq (uint32_t nr, void (*handler)(void)) {
+	if(nr < NUM_SOFTIRQS)
+		softirq_handlers[nr] = handler;
+}
+
+/*
+ * raise_softirq
+ * DESCRIPTION: Asks for a softirq to run once the current interrupt handler is
+ * 				done. The caller has interrupts disabled, normally because it
+ * 				is the handler
+ * INPUT: nr - softirq number
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: sets its bit in softirq_pending
+ */
+void raise_softirq (uint32_t nr) {
+	softirq_pending |= 1 << nr;
+}
+
+/*
+ * do_softirq
+ * DESCRIPTION: Runs the raised softirqs. The interrupt wrappers call it after
+ * 				the handler, with interrupts still disabled, and it enables
+ * 				them while the softirqs run. Work raised meanwhile is picked up
+ * 				by the loop here instead of nesting another do_softirq on the
+ * 				same stack. A softirq may switch tasks, each task has its own
+ * 				softirq_active
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none, with interrupts disabled
+ * SIDE EFFECTS: clears softirq_pending
+ */
+void do_softirq (void) {
+	uint32_t pending, nr;
+
+	if(softirq_active)
+		return;
+	softirq_active = 1;
+
+	while((pending = softirq_pending) != 0) {
+		softirq_pending = 0;
+		for(nr = 0; nr < NUM_SOFTIRQS; nr++) {
+			if((pending & (1 << nr)) && softirq_handlers[nr] != NULL) {
+				sti();
+				softirq_handlers[nr]();
+			}
+		}
+		cli();
+	}
+
+	softirq_active = 0;
+}
@@ -0,0 +1,26 @@
+#ifndef _SOFTIRQ_H
+#define _SOFTIRQ_H
+
+#include "types.h"
+
+/* deferred work, lower numbers run first */
+#define SOFTIRQ_KEYBOARD	0
+#define SOFTIRQ_VIDBUF		1
+#define NUM_SOFTIRQS		2
+
+#ifndef ASM
+
+/* bit per softirq that an interrupt handler raised and that has not run yet */
+extern volatile uint32_t softirq_pending;
+/* nonzero while the current kernel stack is inside do_softirq, switch_to keeps one per task */
+extern volatile uint32_t softirq_active;
+
+/* installs the function that runs softirq nr */
+extern void open_softirq (uint32_t nr, void (*handler)(void));
+/* marks softirq nr to run on the way out of the interrupt, interrupts disabled */
+extern void raise_softirq (uint32_t nr);
+/* runs the pending softirqs with interrupts enabled, called with them disabled */
+extern void do_softirq (void);
+
+#endif /* ASM */
+#endif /* _SOFTIRQ_H */
@@ -0,0 +1,47 @@
+#ifndef _SWITCH_ASM_H
+#define _SWITCH_ASM_H
+
+// byte offsets of the context_t fields, switch_asm.S uses these
+#define CTX_EBX 0
+#define CTX_ESI 4
+#define CTX_EDI 8
+#define CTX_EBP 12
+#define CTX_ESP 16
+#define CTX_EIP 20
+#define CTX_SOFTIRQ 24
+
+// eflags for a new process entering user space, IF set
+#define USER_EFLAGS 0x202
+
+#ifndef ASM
+
+#include "types.h"
+
+/*
+    Kernel context of a task that is switched out. Only the callee-saved
+    registers are kept, everything else is already saved by the C caller.
+    eip is where the task continues, normally right after its call to switch_to.
+    softirq is the task's softirq_active, a task can be switched out of in the
+    middle of a softirq without keeping them from running elsewhere
+*/
+typedef struct context{
+    uint32_t ebx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
+    uint32_t esp;
+    uint32_t eip;
+    uint32_t softirq;
+} context_t;
+
+/* saves the current task into prev and continues next. The call returns when
+ * something switches back to prev, with the ret value that switch passed in.
+ * prev == next returns ret right away without touching any registers */
+extern uint32_t switch_to(context_t* prev, context_t* next, uint32_t ret);
+
+/* first code a new process runs, irets to user space through the frame
+ * execute_c builds on top of the process's kernel stack */
+extern void enter_user(void);
+
+#endif
+#endif
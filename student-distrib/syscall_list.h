@@ -0,0 +1,45 @@
+#ifndef _SYSCALL_LIST_H
+#define _SYSCALL_LIST_H
+
+/*
+    The system calls, in call number order. The kernel builds its dispatch
+    table from this list and ../syscalls builds the SYS_* numbers and the
+    ece391_* wrappers from it, so the two can't disagree. Only macros are
+    defined here, so assembly files can include it too.
+
+    X(num, NAME, name, handler)
+        num     - call number passed in eax, starting at 1
+        NAME    - suffix of the user SYS_* constant
+        name    - suffix of the user ece391_* wrapper
+        handler - kernel C function taking up to three arguments
+*/
+#define SYSCALL_LIST(X)                                             \
+    X(1,  HALT,         halt,           halt_c)                     \
+    X(2,  EXECUTE,      execute,        execute_c)                  \
+    X(3,  READ,         read,           read_c)                     \
+    X(4,  WRITE,        write,          write_c)                    \
+    X(5,  OPEN,         open,           open_c)                     \
+    X(6,  CLOSE,        close,          close_c)                    \
+    X(7,  GETARGS,      getargs,        getargs_c)                  \
+    X(8,  VIDMAP,       vidmap,         vidmap_c)                   \
+    X(9,  SET_HANDLER,  set_handler,    set_handler_c)              \
+    X(10, SIGRETURN,    sigreturn,      sigreturn_c)                \
+    X(11, YIELD,        yield,          yield_c)                    \
+    X(12, SYSSTAT,      sysstat,        sysstat_c)                  \
+    X(13, RING_SETUP,   ring_setup,     ring_setup_c)               \
+    X(14, RING_ENTER,   ring_enter,     ring_enter_c)               \
+    X(15, PIPE,         pipe,           pipe_c)                     \
+    X(16, SHM_CREATE,   shm_create,     shm_create_c)               \
+    X(17, SHM_ATTACH,   shm_attach,     shm_attach_c)               \
+    X(18, SHM_DETACH,   shm_detach,     shm_detach_c)               \
+    X(19, IPC_SEND,     ipc_send,       ipc_send_c)                 \
+    X(20, IPC_RECV,     ipc_recv,       ipc_recv_c)                 \
+    X(21, IPC_CALL,     ipc_call,       ipc_call_c)                 \
+    X(22, GETPID,       getpid,         getpid_c)                   \
+    X(23, VIDMAP_BUFFERED, vidmap_buffered, vidmap_buffered_c)      \
+    X(24, VIDMAP_PRESENT, vidmap_present, vidmap_present_c)         \
+    X(25, FB_MAP,       fb_map,         fb_map_c)                   \
+    X(26, FB_FILL,      fb_fill,        fb_fill_c)                  \
+    X(27, FB_BLIT,      fb_blit,        fb_blit_c)
+
+#endif /* _SYSCALL_LIST_H */
@@ -0,0 +1,40 @@
+#ifndef _SYSSTAT_DATA_H
+#define _SYSSTAT_DATA_H
+
+#include "syscall_list.h"
+
+/*
+    Per-process system call accounting, returned by the sysstat call.
+    Shared with ../syscalls, the includer provides the stdint types.
+
+    Latencies are rdtsc cycles from entry to return, sorted into buckets
+    that grow 4x: bucket i counts calls under 2^(8 + 2i) cycles, the last
+    bucket everything slower. halt never returns and is not counted.
+*/
+
+#define SYSCALL_COUNT(num, NAME, name, handler) + 1
+#define NUM_SYSCALLS (0 SYSCALL_LIST(SYSCALL_COUNT))
+
+#define SYSSTAT_BUCKETS 8
+#define SYSSTAT_FIRST_SHIFT 8
+#define SYSSTAT_BUCKET_SHIFT 2
+#define SYSSTAT_CMD_LEN 32
+
+// which argument to sysstat for the caller's most recently exited child
+#define SYSSTAT_LAST_CHILD -1
+
+typedef struct syscall_stat{
+    uint32_t count;
+    // calls that returned a negative value
+    uint32_t errors;
+    uint64_t cycles;
+    uint32_t hist[SYSSTAT_BUCKETS];
+} syscall_stat_t;
+
+typedef struct sysstat{
+    uint8_t cmd[SYSSTAT_CMD_LEN];
+    // indexed by call number - 1
+    syscall_stat_t calls[NUM_SYSCALLS];
+} sysstat_t;
+
+#endif /* _SYSSTAT_DATA_H */
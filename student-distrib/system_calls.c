@@ -1,4 +1,7 @@
 #include "system_calls.h"
+#include "sched.h"
+#include "system_calls_asm.h"
+#include "pipe.h"
 
 fops_t stdin_ops  =	{&bad_call_open, 	&terminal_read, &bad_call_write, 	 &bad_call_close};
 fops_t stdout_ops = {&bad_call_open, 	&bad_call_read, &terminal_write,	 &bad_call_close};
@@ -11,6 +14,10 @@ int32_t cur_pid = -1;
 int32_t cur_term = 0;
 int32_t running_terms[NUM_TERMS] = {1,0,0};
 pcb_t* pcb_ptr_array[MAX_PCBS] = {NULL};
+// context switched out of by tasks that never resume: boot and halting processes
+static context_t dead_context;
+// protects pcb_ptr_array
+spinlock_t pcb_lock = SPINLOCK_INIT("pcb");
 /* Function to parse the typed buffer */
 void parse_buff(const uint8_t* buff, uint8_t* command, uint8_t* args);
 
@@ -70,27 +77,59 @@ int32_t bad_call_write(int32_t fd, const void* buf, int32_t nbytes) {
  * OUTPUT: n/a
  * RETURNS: n/a
  * SIDE EFFECTS: kills current process, closes its files, updates pcb_table,
- * 				 returns to parent process or executes shell
+ * 				 returns to parent process or executes shell. A detached
+ * 				 process just gives the CPU to the next runnable one
  */
 int32_t halt_c (uint8_t status) {
 	uint32_t  i;
-	uint32_t j;
-	int32_t term_in_use;
-	// prevent sched from changes cur_pid
-	cli();
 	int32_t pid = cur_pid;
 
 	if(pcb_ptr_array[cur_pid]->vidmap_ptr != NULL){
+		vidbuf_release(cur_pid);
 		vidmap_close();
+		screen_pin(pcb_ptr_array[cur_pid]->term_id, 0);
 	}
+	fb_release(cur_pid);
 
 	int32_t parent_pid = pcb_ptr_array[pid]->parent_pid;
+	// processes killed by an exception report 256 to the parent's execute
+	uint32_t ret = pcb_ptr_array[pid]->error_flag ? EXCEPTION_STATUS : (uint32_t)status;
 
 	for(i = 0; i< MAX_OPEN_FILES; i++){
 		close_c(i);
 	}
+	// close_c leaves stdin and stdout alone, in a pipeline they can be pipe ends
+	for(i = 0; i < 2; i++){
+		if(pcb_ptr_array[pid]->file_desc_array[i].ops_table.close == &pipe_close)
+			pipe_close(i);
+	}
+	shm_detach_all();
+	ipc_exit();
+
+	// a detached process doesn't return to its parent, run whatever is next
+	if(pcb_ptr_array[pid]->detached){
+		cli();
+		if(pcb_ptr_array[parent_pid]->pipe_child == pid){
+			pcb_ptr_array[parent_pid]->pipe_child = -1;
+			// blocked only if the pipeline's right side is done and it waits for us
+			if(pcb_ptr_array[parent_pid]->state == TASK_BLOCKED){
+				pcb_ptr_array[parent_pid]->isParent = 0;
+				sched_wake(parent_pid);
+			}
+		}
+		free_pcb(pid);
+		cur_pid = parent_pid;
+		sched_exit();
+	}
 
-	pcb_ptr_array[pid] = NULL;
+	// the parent can read these with sysstat once we're gone
+	if(parent_pid != -1){
+		memcpy(&pcb_ptr_array[parent_pid]->child_stats, &pcb_ptr_array[pid]->stats, sizeof(sysstat_t));
+	}
+
+	// from here the process is gone, sched must not see it or change cur_pid
+	cli();
+	free_pcb(pid);
 
 	cur_pid = parent_pid;
 
@@ -100,70 +139,46 @@ int32_t halt_c (uint8_t status) {
 	}
 
 	for(i = 0; i < NUM_TERMS; i++){
-		if(running_terms[i]){
-			term_in_use = 0;
-			// there should be at least 1 process with term_id == i
-			for(j = 1; j < MAX_PCBS; j++){
-				if(pcb_ptr_array[j] != NULL){
-					if(pcb_ptr_array[j]->term_id == i){
-						term_in_use = 1;
-						break;
-					}
-				}
-			}
-			// if term should be running but no process, edit new pcb to that term
-			if(!term_in_use){
-				uint8_t *shell = (uint8_t*)"shell";
-				execute_c(shell);
-			}
+		// if term should be running but no process, start a new shell for it
+		if(running_terms[i] && !term_has_process(i)){
+			uint8_t *shell = (uint8_t*)"shell";
+			execute_c(shell);
 		}
 	}
 
 
 	//update PTE for 128MB
-	new_task_page(parent_pid);
+	switch_task_page(parent_pid);
 
 	// set parent to have no children
 	pcb_ptr_array[cur_pid]->isParent = 0;
 
 	tss.esp0 = pcb_ptr_array[cur_pid]->kernel_esp;
+	sched_reset_slice();
 
-	sti();
-	//JMP to execute return
-	asm volatile(
-		"movl %0, %%esp \n"
-		"movl %1, %%ebp \n"
-		"movl %2, %%eax \n"
-		"jmp RETURN_ON_HALT"
-		::"r"(pcb_ptr_array[parent_pid]->user_esp), "r"(pcb_ptr_array[parent_pid]->user_ebp), "r"((uint32_t)status)
-		: "esp", "ebp", "eax"
-	);
+	// continue the parent inside its execute call, which returns ret
+	switch_to(&dead_context, &pcb_ptr_array[parent_pid]->context, ret);
 
 	return 0;
 }
 /*
- * execute_c
- * DESCRIPTION: executes current process
- * INPUT: uint8_t* command: command to be executed
- * OUTPUT: depends which command is called
- * RETURNS: 0 on success, -1 on failure
- * SIDE EFFECTS: executes current process
+ * load_program
+ * DESCRIPTION: checks a command names an executable, makes a PCB for it and
+ * 				copies the program to its page
+ * INPUT: command - program name and arguments, in kernel memory or in the
+ * 				  caller's page
+ * 		  eip - gets the program's entry point
+ * OUTPUT: n/a
+ * RETURNS: pid of the new process, -1 on failure
+ * SIDE EFFECTS: none, the caller's page stays mapped at 128MB
  */
-int32_t execute_c (const uint8_t* command) {
+static int32_t load_program (const uint8_t* command, uint32_t* eip) {
 	int i;
-	int j;
-	int term_in_use;
+	uint32_t flags;
 	uint8_t cmd[BUF_LEN] = {0};
 	uint8_t args[BUF_LEN] = {0};
 	uint8_t buf[NUM_OF_MAGIC_NUMBERS];
 
-	if(command == NULL) {
-		return -1;
-	}
-
-	// critical section added to avoid switching terms while editing global variables
-	cli();
-
 	parse_buff(command,cmd,args);
 
 	dentry_t file;
@@ -178,6 +193,10 @@ int32_t execute_c (const uint8_t* command) {
 	if(buf[0] != MAGIC_NUM_0 || buf[1] != MAGIC_NUM_1 || buf[2] != MAGIC_NUM_2 || buf[3] != MAGIC_NUM_3){
 		return -1;
 	}
+	// the copy goes straight to physical memory, it must not run into the next process's page
+	if(file.file_size > FOUR_MB - (MB128 & (FOUR_MB - 1))){
+		return -1;
+	}
 
 	/* Start process */
 	int32_t new_pid = init_pcb(args, strlen((int8_t*)args));
@@ -190,100 +209,224 @@ int32_t execute_c (const uint8_t* command) {
 
 	// save cmd in cb for debugging purposes
 	memcpy(pcb_ptr_array[new_pid]->cmd,cmd,strlen((int8_t*)cmd));
+	strncpy((int8_t*)pcb_ptr_array[new_pid]->stats.cmd, (int8_t*)cmd, SYSSTAT_CMD_LEN - 1);
 
 	if(!strncmp((int8_t*)cmd,(int8_t*)"shell",strlen((int8_t*)cmd))){
 		/* Check if the new process should be in a new term by checking term_running and looping over the pcbs*/
 		for(i = 0; i < NUM_TERMS; i++){
-			if(running_terms[i]){
-				term_in_use = 0;
-				// there should be at least 1 process with term_id == i
-				for(j = 1; j < MAX_PCBS; j++){
-					if(pcb_ptr_array[j] != NULL){
-						if(pcb_ptr_array[j]->term_id == i){
-							term_in_use = 1;
-							break;
-						}
-					}
-				}
-				// if term should be running but no process, edit new pcb to that term
-				if(!term_in_use){
-					pcb_ptr_array[new_pid]->term_id = i;
-					pcb_ptr_array[new_pid]->parent_pid = -1;
-				}
+			// if term should be running but no process, edit new pcb to that term
+			if(running_terms[i] && !term_has_process(i)){
+				pcb_ptr_array[new_pid]->term_id = i;
+				pcb_ptr_array[new_pid]->parent_pid = -1;
 			}
 		}
 	}
 	/* Create new page for process */
+	flags = spin_lock_irqsave(&page_lock);
 	new_task_page(new_pid);
+	spin_unlock_irqrestore(&page_lock, flags);
 
-	/* Copy program data */
-	uint32_t num_bytes_copied = (uint32_t)read_data(file.inode_index, 0, (uint8_t*)MB128, file.file_size);
+	/* Copy program data through the kernel's mapping of the page, with interrupts on */
+	uint32_t num_bytes_copied = (uint32_t)read_data(file.inode_index, 0,
+		(uint8_t*)TASK_ADDRESS(new_pid) + (MB128 & (FOUR_MB - 1)), file.file_size);
 	if(num_bytes_copied != file.file_size) {
 		printf("Error copying program data.");
+		free_pcb(new_pid);
 		return -1;
 	}
 
-	/* Context switch */
+	/* Get instruction pointer from file */
+	e = read_data(file.inode_index, 24, buf, 4);
+	if (e != 4) {
+		printf("Couldn't load instruction pointer of file.");
+		free_pcb(new_pid);
+		return -1;
+	}
 
-	//save parent's values, if exists
-	if(cur_pid > -1) {
-		pcb_t* cur_pcb = pcb_ptr_array[cur_pid];
+	*eip = (((uint32_t) buf[3]) << 24 | ((uint32_t) buf[2]) << 16 | ((uint32_t) buf[1]) << 8 | ((uint32_t) buf[0]));
+	return new_pid;
+}
+
+/*
+ * start_program
+ * DESCRIPTION: makes a loaded process runnable. Normally the caller waits in
+ * 				here until the child halts. A detached child is only queued, it
+ * 				runs alongside the caller and halts without returning to it
+ * INPUT: new_pid - process from load_program
+ * 		  eip - its entry point
+ * 		  detached - 1 to return right away
+ * OUTPUT: n/a
+ * RETURNS: the child's halt status, 0 for a detached child
+ * SIDE EFFECTS: switches to the child unless it is detached
+ */
+static int32_t start_program (int32_t new_pid, uint32_t eip, uint8_t detached) {
+	uint32_t flags;
+	uint32_t ret;
+	pcb_t* new_pcb = pcb_ptr_array[new_pid];
+
+	/* Build the IRET frame at the top of the new kernel stack for enter_user */
+	uint32_t* frame = (uint32_t*)new_pcb->kernel_esp - IRET_FRAME_TOP;
+	frame[0] = eip;
+	frame[1] = USER_CS;
+	frame[2] = USER_EFLAGS;
+	frame[3] = new_pcb->user_esp;
+	frame[4] = USER_DS;
+
+	new_pcb->context.ebx = 0;
+	new_pcb->context.esi = 0;
+	new_pcb->context.edi = 0;
+	new_pcb->context.ebp = 0;
+	new_pcb->context.esp = (uint32_t)frame;
+	new_pcb->context.eip = (uint32_t)enter_user;
+	new_pcb->context.softirq = 0;
+
+	if(detached) {
+		// sched switches the page and kernel stack when it first picks the child
+		cli_and_save(flags);
+		new_pcb->detached = 1;
+		new_pcb->state = TASK_RUNNABLE;
+		restore_flags(flags);
+		return 0;
+	}
+
+	/* Context switch, sched must not run until the new process is on its own stack */
+	context_t* prev_context;
+	cli_and_save(flags);
+
+	//the idle task is switched out if a keyboard interrupt started this shell while idle
+	if(idle_active) {
+		prev_context = &idle_context;
+		sched_leave_idle();
+	}
+	//save parent's context, if exists
+	else if(cur_pid > -1) {
+		pcb_t* cur_pcb;
+
+	// the caller waits for both sides, so there has to be one
+	if(cur_pid == -1)
+		return -1;
+	cur_pcb = pcb_ptr_array[cur_pid];
 		// if the new process is on the same term, cur process must be a parent of the new process
-		if(pcb_ptr_array[new_pid]->term_id == cur_pcb->term_id){	
+		if(new_pcb->term_id == cur_pcb->term_id){	
 			cur_pcb->isParent = 1;
 		}
-		
-		asm volatile("movl %%esp, %0 	\n"
-					 "movl %%ebp, %1 	\n"
-					: "=r"(cur_pcb->user_esp),
-					  "=g"(cur_pcb->user_ebp)
-		);
-
+		prev_context = &cur_pcb->context;
+	}
+	else {
+		prev_context = &dead_context;
 	}
 
 	/* Update PCB data */
+	// the child's page goes in at 128MB only now, load_program copied it in elsewhere
+	switch_task_page(new_pid);
 	cur_pid = new_pid;
-	pcb_t* new_pcb = pcb_ptr_array[new_pid];
+	sched_reset_slice();
+	// only now can sched pick it
+	new_pcb->state = TASK_RUNNABLE;
 	//esp points to bottom of PCB data segment
 	tss.esp0 = new_pcb->kernel_esp;
 	tss.ss0 = KERNEL_DS;
 
-	/* Return to executable (IRET) */
+	/* Return to parent with the child's halt status */
+	ret = switch_to(prev_context, &new_pcb->context, 0);
+	restore_flags(flags);
+	return (int32_t)ret;
+}
 
-	/* Get instruction pointer from file */
-	e = read_data(file.inode_index, 24, buf, 4);
-	if (e != 4) {
-		printf("Couldn't load instruction pointer of file.");
+/*
+ * execute_pipeline
+ * DESCRIPTION: runs "left | right". left is started detached with its stdout
+ * 				writing into a new pipe, then right runs with its stdin reading
+ * 				from it and the caller waits for right like for any program.
+ * 				The caller then waits for left too, so left's parent_pid stays
+ * 				valid and its terminal isn't left to it alone
+ * INPUT: command - the whole command line
+ * OUTPUT: n/a
+ * RETURNS: right's halt status, -1 if either side can't be loaded
+ * SIDE EFFECTS: starts two processes, returns once both have halted
+ */
+static int32_t execute_pipeline (const uint8_t* command) {
+	uint8_t line[BUF_LEN];
+	uint8_t* right;
+	uint32_t left_eip, right_eip;
+	int32_t left_pid, right_pid, pipe;
+	int32_t i, ret;
+	pcb_t* cur_pcb = pcb_ptr_array[cur_pid];
+
+	// the command is split in place, and it may live in the caller's page
+	strncpy((int8_t*)line, (int8_t*)command, BUF_LEN - 1);
+	line[BUF_LEN - 1] = '\0';
+	for(i = 0; line[i] != '|'; i++){
+		if(line[i] == '\0')
+			return -1;
+	}
+	right = line + i + 1;
+	// parse_buff only drops one trailing space
+	for(line[i] = '\0'; i > 0 && line[i - 1] == ' '; i--)
+		line[i - 1] = '\0';
+	// one pipe per command line
+	for(i = 0; right[i] != '\0'; i++){
+		if(right[i] == '|')
+			return -1;
+	}
+
+	if(-1 == (pipe = pipe_create()))
+		return -1;
+	left_pid = load_program(line, &left_eip);
+	right_pid = (left_pid == -1) ? -1 : load_program(right, &right_eip);
+	if(right_pid == -1) {
+		if(left_pid != -1)
+			free_pcb(left_pid);
+		pipe_free(pipe);
 		return -1;
 	}
 
-	uint32_t eip = (((uint32_t) buf[3]) << 24 | ((uint32_t) buf[2]) << 16 | ((uint32_t) buf[1]) << 8 | ((uint32_t) buf[0]));
+	pipe_attach(left_pid, 1, pipe, PIPE_WRITE_END);
+	pipe_attach(right_pid, 0, pipe, PIPE_READ_END);
+	cur_pcb->pipe_child = left_pid;
+	start_program(left_pid, left_eip, 1);
+	ret = start_program(right_pid, right_eip, 0);
 
+	// left halting clears pipe_child and, since we're blocked, isParent
+	cli();
+	while(cur_pcb->pipe_child != -1){
+		// Ctrl+C goes to left meanwhile, not to us
+		cur_pcb->isParent = 1;
+		sched_block();
+		cli();
+	}
 	sti();
-	/* Modify stack for faux IRET */
-
-	asm volatile("          \n\
-		cli 				\n\
-		movw  %0, %%ax      \n\
-		movw %%ax, %%ds		\n\
-		pushl %0			\n\
-		pushl %1			\n\
-		pushfl          	\n\
-		popl %%eax			\n\
-		orl $0x200, %%eax   \n\
-		pushl %%eax			\n\
-		pushl %2			\n\
-		pushl %3			\n\
-		iret 				\n\
-		RETURN_ON_HALT:     \n\
-		"
-		:
-		: "g"(USER_DS), "g"(new_pcb->user_esp), "g"(USER_CS), "g"(eip)
-		: "eax", "memory"
-	);
-
-	/* Return to user */
-	return 0;
+	return ret;
+}
+
+/*
+ * execute_c
+ * DESCRIPTION: executes current process
+ * INPUT: uint8_t* command: command to be executed, "a | b" pipes a's
+ * 		  output into b
+ * OUTPUT: depends which command is called
+ * RETURNS: 0 on success, -1 on failure
+ * SIDE EFFECTS: executes current process
+ */
+int32_t execute_c (const uint8_t* command) {
+	int i;
+	uint32_t eip;
+	int32_t new_pid;
+
+	if(command == NULL) {
+		return -1;
+	}
+
+	for(i = 0; command[i] != '\0'; i++){
+		if(command[i] == '|')
+			return execute_pipeline(command);
+	}
+
+	new_pid = load_program(command, &eip);
+	if(new_pid == -1) {
+		return -1;
+	}
+	return start_program(new_pid, eip, 0);
 }
 /*
  * read_c
@@ -320,18 +463,23 @@ int32_t read_c (int32_t fd, void* buf, int32_t nbytes) {
  * SIDE EFFECTS: writes to terminal
  */
 int32_t write_c (int32_t fd, const void* buf, int32_t nbytes) {
+	file_desc_t* file;
 	/* Sanity checks */
 	if(fd < 0 || fd >= MAX_OPEN_FILES)
 		return -1;
-	if(pcb_ptr_array[cur_pid]->file_desc_array[fd].flags == 0)
-		return -1;
 	if(buf == 0) {
 		return -1;
 	}
 	if(nbytes < 0) {
 		return -1;
 	}
-	return (pcb_ptr_array[cur_pid]->file_desc_array[fd].ops_table.write)(fd, buf, nbytes);
+	file = &pcb_ptr_array[cur_pid]->file_desc_array[fd];
+	if(file->flags == 0)
+		return -1;
+	// nothing to write, skip the driver
+	if(nbytes == 0)
+		return 0;
+	return (file->ops_table.write)(fd, buf, nbytes);
 }
 /*
  * open_c
@@ -392,17 +540,37 @@ int32_t vidmap_c(uint8_t** screen_start) {
 		return -1;
 	}
 
-	cli();
-	
-	//helper function in paging
+	//the screen has to stay where vidmap maps it while this process has it
+	if(pcb_ptr_array[cur_pid]->vidmap_ptr == NULL){
+		screen_pin(pcb_ptr_array[cur_pid]->term_id, 1);
+	}
+
+	//a back buffer is flushed before text memory replaces it
+	vidbuf_release(cur_pid);
+
+	//helper function in paging, takes page_lock
 	*screen_start = vidmap_init();
 	//created flag to test if writing to screen
 	pcb_ptr_array[cur_pid]->vidmap_ptr = *screen_start;
 
-	sti();
 	return 0;
 }
 
+/*
+ * user_range_ok
+ * DESCRIPTION: Checks that a buffer lies inside the program's page
+ * INPUT: addr - start of the buffer
+ * 		  len - its length
+ * OUTPUT: n/a
+ * RETURNS: 1 if the whole buffer is mapped for the program, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+int32_t user_range_ok (uint32_t addr, int32_t len) {
+	if(len < 0)
+		return 0;
+	return addr >= MB128 && addr < MB132 && (uint32_t)len <= MB132 - addr;
+}
+
 /*
  * getargs_c (uint8_t* buf, int32_t nbytes)
  * DESCRIPTION: Copies arguments into userspace
@@ -415,33 +583,124 @@ int32_t vidmap_c(uint8_t** screen_start) {
  */
 
 int32_t getargs_c (uint8_t* buf, int32_t nbytes) {
-	int32_t len, i;
+	int32_t len;
 	uint8_t* input;
-	if((uint32_t)buf < MB128 || (uint32_t)buf > MB132)
-		return -1;
-
 	if(buf == NULL || nbytes <= 0) return -1;
+	// the whole buffer has to be in the program's page
+	if(!user_range_ok((uint32_t)buf, nbytes))
+		return -1;
 
 	input = pcb_ptr_array[cur_pid]->args;
+	len = strlen((int8_t*)input);
 
-  //Step 1: Get length
-    len = 0;
-    while(input[len] != '\0') {
-        len++;
-    }
+	//Copy to userspace, then clear only what the args didn't fill
+	if(len > nbytes) len = nbytes;
+	memcpy(buf, input, len);
+	memset(buf + len, '\0', nbytes - len);
+	if(len == 0)
+		return -1;
+	return 0;
+}
+
+/*
+ * yield_c (void)
+ * DESCRIPTION: Gives the rest of the time slice to another runnable process
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: 0
+ * SIDE EFFECTS: may context switch
+ */
+int32_t yield_c (void) {
+	sched_yield();
+	return 0;
+}
 
-	for(i =0; i<nbytes; i++) {
-		buf[i] = '\0';
+/*
+ * sysstat_c (int32_t which, void* buf, int32_t nbytes)
+ * DESCRIPTION: Copies system call statistics into userspace
+ * INPUT: which - pid of a running process, or SYSSTAT_LAST_CHILD for the
+ * 				  caller's most recently exited child
+ * 		  buf - sysstat_t to fill in
+ * 		  nbytes - size of buf
+ * OUTPUT: n/a
+ * RETURNS: number of bytes copied, -1 on failure
+ * SIDE EFFECTS: none
+ */
+int32_t sysstat_c (int32_t which, void* buf, int32_t nbytes) {
+	sysstat_t* stats;
+	uint32_t flags;
+
+	if(buf == NULL || nbytes < (int32_t)sizeof(sysstat_t))
+		return -1;
+	if((uint32_t)buf < MB128 || (uint32_t)buf + sizeof(sysstat_t) > MB132)
+		return -1;
+
+	if(which == SYSSTAT_LAST_CHILD){
+		memcpy(buf, &pcb_ptr_array[cur_pid]->child_stats, sizeof(sysstat_t));
+		return sizeof(sysstat_t);
 	}
-	if(len == 0)
+	if(which < 0 || which >= MAX_PCBS)
 		return -1;
 
-    //Copy to userspace
-    if(len > nbytes) len = nbytes;
-    memcpy(buf, input, len);
-    return 0;
-    //return copy_to_user(buf, &input + str_start, nbytes);
+	// the process could halt while we copy
+	flags = spin_lock_irqsave(&pcb_lock);
+	if(pcb_ptr_array[which] == NULL){
+		spin_unlock_irqrestore(&pcb_lock, flags);
+		return -1;
+	}
+	stats = &pcb_ptr_array[which]->stats;
+	memcpy(buf, stats, sizeof(sysstat_t));
+	spin_unlock_irqrestore(&pcb_lock, flags);
+	return sizeof(sysstat_t);
+}
+
+/*
+ * syscall_account
+ * DESCRIPTION: Counts a finished system call and files its latency in the histogram
+ * INPUT: ret - what the call returned
+ * 		  start - rdtsc at entry
+ * 		  num - call number, already checked by the entry path
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: updates the current process's stats
+ */
+void syscall_account (int32_t ret, uint32_t start, uint32_t num) {
+	uint32_t cycles = rdtsc() - start;
+	uint32_t bucket = 0;
+	syscall_stat_t* stat;
+
+	if(cur_pid < 0 || pcb_ptr_array[cur_pid] == NULL)
+		return;
+	stat = &pcb_ptr_array[cur_pid]->stats.calls[num - 1];
+
+	stat->count++;
+	if(ret < 0)
+		stat->errors++;
+	stat->cycles += cycles;
+	while(bucket < SYSSTAT_BUCKETS - 1
+		&& cycles >= (1U << (SYSSTAT_FIRST_SHIFT + bucket * SYSSTAT_BUCKET_SHIFT))){
+		bucket++;
+	}
+	stat->hist[bucket]++;
+}
 
+/*
+ * sysenter_init
+ * DESCRIPTION: Sets up the sysenter MSRs of the calling processor
+ * INPUT: cpu_tss - the processor's tss, sysenter takes its stack from esp0
+ * OUTPUT: prints a warning if the processor has no sysenter
+ * RETURNS: none
+ * SIDE EFFECTS: the stack MSR points at cpu_tss->esp0 instead of a stack, so
+ * 				 sysenter_handler picks up whatever esp0 the last switch set
+ */
+void sysenter_init(tss_t* cpu_tss) {
+	if(!(cpuid_features() & CPUID_SEP)){
+		printf("sysenter not supported, system calls use int 0x80\n");
+		return;
+	}
+	wrmsr(SYSENTER_CS_MSR, KERNEL_CS);
+	wrmsr(SYSENTER_ESP_MSR, (uint32_t)&cpu_tss->esp0);
+	wrmsr(SYSENTER_EIP_MSR, (uint32_t)sysenter_handler);
 }
 
 /*
@@ -537,14 +796,17 @@ void parse_buff(const uint8_t* buff, uint8_t* command, uint8_t* args){
 int32_t init_pcb(uint8_t* buf, int32_t len){
     int i;
     int32_t new_pid;
+    uint32_t flags;
 	if(buf == NULL || len < 0)
 		return -1;
-    // check for a valid pid entry
+    // check for a valid pid entry and claim it
+    flags = spin_lock_irqsave(&pcb_lock);
     for(i = 0; i < MAX_PCBS; i++){
         if(pcb_ptr_array[i] == NULL){
             break;
         }
         else if(i == MAX_PCBS - 1){
+            spin_unlock_irqrestore(&pcb_lock, flags);
             return -1;
         }
     }
@@ -552,6 +814,9 @@ int32_t init_pcb(uint8_t* buf, int32_t len){
     new_pid = i;
     // initialize the new entry in the array in kernel memory
     pcb_ptr_array[new_pid] = (pcb_t*) (MB8 - (new_pid+1)*KB8);
+    // not runnable until execute has its stack ready
+    pcb_ptr_array[new_pid]->state = TASK_BLOCKED;
+    spin_unlock_irqrestore(&pcb_lock, flags);
     pcb_ptr_array[new_pid]->pid = new_pid;
     pcb_ptr_array[new_pid]->parent_pid = cur_pid;
 	pcb_ptr_array[new_pid]->term_id = cur_term;
@@ -586,13 +851,73 @@ int32_t init_pcb(uint8_t* buf, int32_t len){
 
     pcb_ptr_array[new_pid]->kernel_esp = MB8 - new_pid*KB8 - aligned_1;
     pcb_ptr_array[new_pid]->user_esp = MB132 - aligned_1;
-    pcb_ptr_array[new_pid]->user_ebp = MB132 - aligned_1;
 	pcb_ptr_array[new_pid]->vidmap_ptr = NULL;
+	pcb_ptr_array[new_pid]->vidmap_buffered = VIDBUF_OFF;
+	pcb_ptr_array[new_pid]->fb_mapped = 0;
+	pcb_ptr_array[new_pid]->ring = NULL;
+	memset(pcb_ptr_array[new_pid]->sig_handlers, 0, sizeof(pcb_ptr_array[new_pid]->sig_handlers));
+	pcb_ptr_array[new_pid]->sig_pending = 0;
+	pcb_ptr_array[new_pid]->sig_masked = 0;
+	pcb_ptr_array[new_pid]->sig_restore = 0;
+	pcb_ptr_array[new_pid]->alarm_deadline = 0;
 	pcb_ptr_array[new_pid]->error_flag = 0;
 	pcb_ptr_array[new_pid]->isParent = 0;
+	pcb_ptr_array[new_pid]->detached = 0;
+	pcb_ptr_array[new_pid]->pipe_child = -1;
+	pcb_ptr_array[new_pid]->ipc_state = IPC_IDLE;
+	pcb_ptr_array[new_pid]->ipc_peer = IPC_ANY;
+	for(i = 0; i < SHM_MAX_ATTACH; i++){
+		pcb_ptr_array[new_pid]->shm_ids[i] = -1;
+		pcb_ptr_array[new_pid]->shm_addrs[i] = 0;
+	}
+	pcb_ptr_array[new_pid]->level = 0;
+	pcb_ptr_array[new_pid]->slice_left = MLFQ_SLICE(0);
+	pcb_ptr_array[new_pid]->sleeping = 0;
+	pcb_ptr_array[new_pid]->wake_tsc = 0;
+	pcb_ptr_array[new_pid]->term_reading = 0;
+	memset(&pcb_ptr_array[new_pid]->stats, 0, sizeof(sysstat_t));
+	memset(&pcb_ptr_array[new_pid]->child_stats, 0, sizeof(sysstat_t));
     return new_pid;
 }
 
+/*
+ * free_pcb
+ * DESCRIPTION: Releases a pid, used by halt and by execute when loading fails
+ * INPUT: pid - process to remove
+ * OUTPUT: none
+ * RETURNS: none
+ * SIDE EFFECTS: clears the pcb_ptr_array entry
+ */
+void free_pcb(int32_t pid){
+	uint32_t flags = spin_lock_irqsave(&pcb_lock);
+	signal_work &= ~(1 << pid);
+	pcb_ptr_array[pid] = NULL;
+	spin_unlock_irqrestore(&pcb_lock, flags);
+}
+
+/*
+ * term_has_process
+ * DESCRIPTION: Checks whether any process is attached to a terminal
+ * INPUT: term - terminal to check
+ * OUTPUT: none
+ * RETURNS: 1 if a process (other than pid 0) uses the terminal, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+int32_t term_has_process(int32_t term){
+	int32_t j;
+	int32_t term_in_use = 0;
+	uint32_t flags = spin_lock_irqsave(&pcb_lock);
+	// there should be at least 1 process with term_id == term
+	for(j = 1; j < MAX_PCBS; j++){
+		if(pcb_ptr_array[j] != NULL && pcb_ptr_array[j]->term_id == term){
+			term_in_use = 1;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&pcb_lock, flags);
+	return term_in_use;
+}
+
 /*
  * file_open
  * DESCRIPTION: Attempts to open new file by checking the PCB and its file descriptor array.
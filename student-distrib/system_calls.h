@@ -9,6 +9,15 @@
 #include "paging.h"
 #include "x86_desc.h"
 #include "interrupts.h"
+#include "switch_asm.h"
+#include "lock.h"
+#include "sysstat_data.h"
+#include "ring.h"
+#include "signal.h"
+#include "shm.h"
+#include "ipc.h"
+#include "vidbuf.h"
+#include "fb.h"
 
 #define NUM_TERMS 3
 #define aligned_1 4
@@ -20,12 +29,21 @@
 #define MB4 0x400000
 #define MB128 0x8048000
 #define MB132 0x8400000
+// iret frame is 5 words, the last (ss) sits at kernel_esp
+#define IRET_FRAME_TOP 4
 #define NUM_OF_MAGIC_NUMBERS  4
 #define MAGIC_NUM_0         0x7f
 #define MAGIC_NUM_1         0x45
 #define MAGIC_NUM_2         0x4c
 #define MAGIC_NUM_3         0x46
 
+/* execute returns this when the child was killed by an exception */
+#define EXCEPTION_STATUS    256
+
+/* Scheduling states stored in pcb_t.state */
+#define TASK_RUNNABLE       0
+#define TASK_BLOCKED        1
+
 
 /*  Struct for file operations 
     Used in table.              */
@@ -53,7 +71,8 @@ typedef struct file_desc{
 /*
     PCB struct used for every process.
     Currently holds proccess id, parent process id, esp for process in kernel memory,
-    buffer to hold args, and file descriptor array
+    user stack the process starts on, saved kernel context while switched out,
+    buffer to hold args, file descriptor array and system call statistics
 */
 typedef struct pcb{
     int32_t pid;
@@ -61,16 +80,53 @@ typedef struct pcb{
     int32_t term_id;
     uint32_t kernel_esp;
     uint32_t user_esp;
-    uint32_t user_ebp;
+    context_t context;
     uint8_t error_flag;
     uint8_t isParent;
+    volatile uint8_t state;
+    uint8_t level;
+    uint8_t sleeping;
+    uint32_t slice_left;
+    uint32_t sleep_deadline;
+    uint32_t wake_tsc;
+    // set while blocked in terminal_read, only those readers wake on a new line
+    uint8_t term_reading;
     uint8_t*  vidmap_ptr;
+    // VIDBUF_* mode while vidmap_ptr is a back buffer
+    uint8_t vidmap_buffered;
+    // set while the framebuffer is mapped at FB_ADDR
+    uint8_t fb_mapped;
     uint8_t cmd[BUF_LEN];
     uint8_t args[BUF_LEN];
     file_desc_t file_desc_array[MAX_OPEN_FILES];
+    // system call accounting for this process and for its last child to exit
+    sysstat_t stats;
+    sysstat_t child_stats;
+    // submission/completion rings in user memory, NULL until ring_setup
+    ring_t* ring;
+    // user handler per signal, 0 for the default action
+    uint32_t sig_handlers[NUM_SIGNALS];
+    uint32_t sig_pending;
+    // set while a handler runs, until its sigreturn
+    uint8_t sig_masked;
+    uint8_t sig_restore;
+    uint32_t alarm_deadline;
+    // started by a pipeline, runs alongside its parent and halts without returning to it
+    uint8_t detached;
+    // left side of this process's pipeline, -1 once it halted. execute waits for it
+    int32_t pipe_child;
+    // attached shared memory segments and where they are, -1 for a free slot
+    int32_t shm_ids[SHM_MAX_ATTACH];
+    uint32_t shm_addrs[SHM_MAX_ATTACH];
+    // IPC_* state while blocked in send, call or recv and the pid it waits on
+    uint8_t ipc_state;
+    int32_t ipc_peer;
 } pcb_t;
 
 
+// jump table of an unused file descriptor, drivers closing a descriptor put it back
+extern fops_t bad_ops;
+
 // global variable for the current process id. This id is an entry in the proccess pointer array
 extern int32_t cur_pid;
 extern int32_t cur_term;
@@ -80,10 +136,16 @@ extern int32_t running_terms[NUM_TERMS];
 // if process not intialized, the entry is null
 // when process halts, it must reset its entry to NULL
 extern pcb_t* pcb_ptr_array[MAX_PCBS];
+// protects pcb_ptr_array
+extern spinlock_t pcb_lock;
 
 // Function to initialize a new PCB takes the buffer to retrieve args as input
 // returns the process id which is the index of the pcb ptr in the global pcb_ptr_array
 extern int32_t init_pcb(uint8_t* buf, int32_t len);
+// releases a pid from pcb_ptr_array
+extern void free_pcb(int32_t pid);
+// 1 if some process is attached to the terminal
+extern int32_t term_has_process(int32_t term);
 
 extern int32_t halt_c (uint8_t status);
 
@@ -101,6 +163,16 @@ extern int32_t vidmap (uint8_t** screen_start);
 
 extern int32_t getargs_c (uint8_t* buf, int32_t nbytes);
 
+// 1 if addr to addr + len is inside the program's page
+extern int32_t user_range_ok (uint32_t addr, int32_t len);
+
+extern int32_t yield_c (void);
+
+extern int32_t sysstat_c (int32_t which, void* buf, int32_t nbytes);
+
+// records one system call in the current process's stats, called by both entry paths
+extern void syscall_account (int32_t ret, uint32_t start, uint32_t num);
+
 extern int32_t bad_call_open (const uint8_t* str);
 extern int32_t bad_call_read (int32_t fd, void* buf, int32_t nbytes);
 extern int32_t bad_call_write (int32_t fd, const void* buf, int32_t nbytes);
@@ -1,6 +1,13 @@
 #ifndef _SYSTEM_CALLS_ASM_H
 #define _SYSTEM_CALLS_ASM_H
 
+// model specific registers sysenter loads its code segment, stack and entry point from
+#define SYSENTER_CS_MSR     0x174
+#define SYSENTER_ESP_MSR    0x175
+#define SYSENTER_EIP_MSR    0x176
+// cpuid leaf 1 edx bit for sysenter/sysexit
+#define CPUID_SEP           0x800
+
 #ifndef ASM 
 #include "system_calls.h"
 //#include "fs.h"
@@ -8,6 +15,13 @@
 /*function to call when system call occurs
 jumps to correct system call function */
 extern int system_call_handler();
+/*entry point for sysenter, same calls as system_call_handler */
+extern void sysenter_handler();
+/*points the sysenter MSRs of this processor at sysenter_handler and its tss */
+extern void sysenter_init(tss_t* cpu_tss);
+/*system call entries for the vdso page, through sysenter and through int 0x80 */
+extern uint8_t vdso_sysenter[], vdso_sysenter_end[];
+extern uint8_t vdso_int80[], vdso_int80_end[];
 //extern long file_ops_table;
 //extern long dir_ops_table;
 
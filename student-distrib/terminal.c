@@ -1,4 +1,24 @@
 #include "terminal.h"
+#include "system_calls.h"
+#include "sched.h"
+#include "vdso.h"
+
+spinlock_t term_lock = SPINLOCK_INIT("term");
+
+
+/*
+ * Typed input of one terminal. Bytes from head to commit are finished lines
+ * waiting for a reader, commit to tail is the line still being edited.
+ * The indices only ever grow and are masked with INPUT_SIZE - 1
+ */
+typedef struct term_input{
+	uint8_t buf[INPUT_SIZE];
+	uint32_t head;
+	uint32_t commit;
+	uint32_t tail;
+} term_input_t;
+
+static term_input_t term_inputs[NUM_OF_TERMINALS];
 
 
 /* int32_t terminal_open (const uint8_t* filename);
@@ -6,12 +26,8 @@
  * Return Value: none
  * Function: Initializes the terminal */
 int32_t terminal_open (const uint8_t* filename) {
-	int i;
-
-	/* Empty the buffer */
-	for(i=0; i<BUF_LENGTH; i++) {
-		terminal_buf[i] = 0;
-	}
+	/* Empty the input of every terminal */
+	memset(term_inputs, 0, sizeof(term_inputs));
 
 	/* Clear the terminal */
 	clear();
@@ -32,32 +48,30 @@ int32_t terminal_open (const uint8_t* filename) {
  * Writes to the screen from buf, return # bytes written */
 int32_t terminal_write (int32_t fd, const void* given_buf, int32_t length) {
 
-	char* buf = (char*) given_buf;
-	int i;
-
 	/* We expect stdout */
 	if(fd != 1) return -1;
 
-	/* Sanity checks */
+	/* Sanity checks, the buffer is read with term_lock held */
 	if(length < 0) return -1;
 	if(given_buf == NULL) return -1;
+	if(!user_range_ok((uint32_t)given_buf, length)) return -1;
 
-
-	for(i=0; i<length; i++) {
-		putc_syscall(buf[i]);
-	}
-	//putc('\n');
-	return i;
+	/* The whole buffer goes to the screen in one pass */
+	return putbuf_syscall((const uint8_t*) given_buf, length);
 }
 
-/* int32_t terminal_write (int32_t fd, const void* given_buf, int32_t length);
+/* int32_t terminal_read (int32_t fd, void* given_buf, int32_t length);
  * Inputs: int32_t fd - stdin(1) / stdout(0)
-           const void* given_buf - the buffer where input is copied
+           void* given_buf - the buffer where input is copied
            int32_t length - number of bytes to copy
- * Return Value: none
- * Reads from keyboard buffer to buf, return # bytes read */
+ * Return Value: number of bytes read, -1 on failure
+ * Sleeps until the process's terminal has a finished line, then copies from it
+ * up to and including the newline. A short buffer gets the start of the line
+ * and the rest is left for the next read */
 int32_t terminal_read (int32_t fd, void* given_buf, int32_t length) {
 	char* buf = (char*) given_buf;
+	term_input_t* in;
+	int32_t i;
 
 	/* We expect stdin */
 	if(fd != 0) return -1;
@@ -65,44 +79,92 @@ int32_t terminal_read (int32_t fd, void* given_buf, int32_t length) {
 	/* Sanity checks */
 	if(length < 0) return -1;
 	if(given_buf == NULL) return -1;
+	if(!user_range_ok((uint32_t)given_buf, length)) return -1;
 
+	//only lines typed on our own terminal are ours
+	in = &term_inputs[pcb_ptr_array[cur_pid]->term_id];
 
-	//wait until we hit the enter key to copy
-	hit_enter_key[pcb_ptr_array[cur_pid]->term_id] = 0;
-	while(!hit_enter_key[pcb_ptr_array[cur_pid]->term_id]) {}
-	//then copy
+	//output only moves the cursor at the end of a write, put it where typing will echo
+	update_cursor();
 
-	int i; //number of bytes read
-	for (i=0; i<length && i<BUF_LENGTH; i++) {
-		buf[i] = terminal_buf[i];
+	//wait for a finished line, sleeping instead of spinning
+	cli();
+	while(in->head == in->commit) {
+		// a signal that will kill us ends the read, it is delivered on the way out
+		if(signal_fatal_pending(cur_pid)) {
+			pcb_ptr_array[cur_pid]->term_reading = 0;
+			sti();
+			return -1;
+		}
+		pcb_ptr_array[cur_pid]->term_reading = 1;
+		sched_block();
+		cli();
+	}
+	pcb_ptr_array[cur_pid]->term_reading = 0;
+
+	//then copy, the keyboard can't add to the ring until we are done
+	for(i = 0; i < length && in->head != in->commit; i++) {
+		buf[i] = in->buf[in->head++ & (INPUT_SIZE - 1)];
 		/* Stop copying when newline is hit */
-		if(terminal_buf[i] == '\n') {
-			return i+1;
+		if(buf[i] == '\n') {
+			i++;
+			break;
 		}
 	}
-	return i+1;
+	sti();
+	sched_wake_latency();
+	return i;
 }
 
-
-/* int32_t terminal_write (int32_t fd, const void* given_buf, int32_t length);
- * Inputs: int32_t fd - stdin(1) / stdout(0)
-           const void* given_buf - the buffer where input is copied
-           int32_t length - number of bytes to copy
+/* void terminal_input(int32_t term, uint8_t c);
+ * Inputs: int32_t term - terminal the key was typed on, the one on screen
+           uint8_t c - character typed
  * Return Value: none
- * Reads from keyboard buffer to buf, return # bytes read */
-int32_t copy_to_terminal_buffer(char* key_buf, int32_t length) {
-
-	/* Sanity check */
-	if(length < 0) return -1;
-	if(key_buf == NULL) return -1;
-
-	/* Copy keyboard */
-	int i;
-	for(i=0; i<length; i++) {
-		terminal_buf[i] = key_buf[i];
+ * Line discipline, called from the keyboard softirq. Echoes c and adds it to
+ * the line being edited, backspace erases the last character of that line and
+ * newline finishes it and wakes the terminal's readers. Finished lines stay in
+ * the ring until read, so typing ahead of a busy program loses nothing. A full
+ * line or ring drops further characters but always has room for the newline */
+void terminal_input(int32_t term, uint8_t c) {
+	term_input_t* in = &term_inputs[term];
+	uint32_t flags;
+
+	// typing goes back to the screen if history is being paged through
+	scrollback_reset();
+	// readers look at the ring with interrupts off
+	cli_and_save(flags);
+	if(c == ASCII_BACKSPACE) {
+		if(in->tail != in->commit) {
+			in->tail--;
+			putc(c);
+		}
 	}
+	else if(c == '\n') {
+		if(in->tail - in->head < INPUT_SIZE) {
+			in->buf[in->tail++ & (INPUT_SIZE - 1)] = c;
+			in->commit = in->tail;
+			putc(c);
+			sched_wake_term(term);
+		}
+	}
+	else if(in->tail - in->commit < BUF_LENGTH - 1 && in->tail - in->head < INPUT_SIZE - 1) {
+		in->buf[in->tail++ & (INPUT_SIZE - 1)] = c;
+		putc(c);
+	}
+	restore_flags(flags);
+	update_cursor();
+}
 
-	return length;
+/* void terminal_discard_line(int32_t term);
+ * Inputs: int32_t term - terminal number
+ * Return Value: none
+ * Drops the line being edited, finished lines are kept */
+void terminal_discard_line(int32_t term) {
+	uint32_t flags;
+
+	cli_and_save(flags);
+	term_inputs[term].tail = term_inputs[term].commit;
+	restore_flags(flags);
 }
 
 
@@ -125,37 +187,49 @@ void clear_screen() {
 }
 
 /*
- * Function switches between the 3 terminals given a terminal to switch to. This is done using 3 terminal pages
- * each of size 4KB. When a switch is done, all the processes using vidmap must be mapped to the respective term page
+ * Function records how long a switch to a running terminal took
+ * INPUT: rdtsc when the switch started
+ * OUTPUT: NONE
+ * SIDEEFFECTS: publishes the latency in the vDSO for switchbench
+*/
+static void switch_latency(uint32_t start){
+	vdso_set_switch_latency(rdtsc() - start);
+}
+
+/*
+ * Function switches between the 3 terminals given a terminal to switch to. Each terminal has its own
+ * 8KB of VGA text memory, so a switch only moves the display start address. Processes using vidmap
+ * always have their own terminal's memory mapped and need no remapping
  * INPUT: int term_id of end terminal
  * OUTPUT: NONE
- * SIDEEFFECTS: Edits global cur_term, moves data to and from video memory
+ * SIDEEFFECTS: Edits global cur_term and the display start
 */
 int32_t switch_term(int32_t term_id){
 
 	int e;
-	// prevent interrupts while editing video memory and cur_term
+	uint32_t flags;
+	uint32_t start = rdtsc();
+	// keep interrupts and other writers out while editing video memory and cur_term
 
-	cli();
-	if(term_id == cur_term || term_id > 2 || term_id < 0){
-		sti();
+	if(term_id > 2 || term_id < 0){
+		return -1;
+	}
+	flags = spin_lock_irqsave(&term_lock);
+	if(term_id == cur_term){
+		spin_unlock_irqrestore(&term_lock, flags);
 		return -1;
 	} 
 
-	int32_t old_term_id = cur_term;
-
 	cur_term = term_id;			// update cur_term
 
-	// note that KB4 is multiplied by 4 since it was defined for a 4B pointer
-	// memcopy from video mem to the old term
-	memcpy((uint8_t*)(VID_ADDR + KB4*4*(old_term_id + 1)), (uint8_t*)VID_ADDR, KB4*4);
+	// show the new terminal's text memory, nothing is copied
+	switch_screen(term_id);
 
 	// runs if terminal is already running a process
 	if(running_terms[cur_term] == 1){
-		// memcopy from term_id to video mem
-		memcpy((uint8_t*)VID_ADDR, (uint8_t*)(VID_ADDR + KB4*4*(term_id + 1)), KB4*4);
+		spin_unlock_irqrestore(&term_lock, flags);
 		update_cursor();
-		sti();						// allow interrupts
+		switch_latency(start);
 
 		// should call excute shell from here if process not already running on term
 		return 0;
@@ -165,11 +239,11 @@ int32_t switch_term(int32_t term_id){
 	else{
 		clear();
 		running_terms[cur_term] = 1;
-		sti();
+		spin_unlock_irqrestore(&term_lock, flags);
 		update_cursor();
 		e = execute_c((uint8_t*)"shell");
 		if(e == -1){
-			running_terms[cur_term] = 0;
+			running_terms[term_id] = 0;
 		}
 	}
 	return 0;
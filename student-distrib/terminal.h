@@ -5,17 +5,24 @@
 #include "keyboard.h"
 #include "lib.h"
 #include "system_calls.h"
+#include "lock.h"
 
 #define BUF_LENGTH 128
 #define SCR_WIDTH 80
 #define SCR_HEIGHT 25
 #define VID_ADDR 0x000B8000
-#define TERM1_ADDR (VID_ADDR + KB4*4)
-#define TERM2_ADDR (VID_ADDR + 2*KB4*4)
-#define TERM3_ADDR (VID_ADDR + 3*KB4*4)
+// each terminal keeps its screen in its own ring of the 32KB of text memory,
+// scrolling and switching terminals just move the display start
+#define VID_RING_SIZE 0x2000
+#define TERM_VID_ADDR(term) (VID_ADDR + (term) * VID_RING_SIZE)
+// the text memory left after the terminals, history being paged through is shown from here
+#define VIEW_VID_ADDR TERM_VID_ADDR(NUM_OF_TERMINALS)
 
-/* Terminal's buffer */
-char terminal_buf[BUF_LENGTH];
+/* Protects cur_term, the screen positions and video memory */
+extern spinlock_t term_lock;
+
+/* Input ring of each terminal, a power of two so indices can run free */
+#define INPUT_SIZE 512
 
 
 /* Functions used by terminal.c */
@@ -24,7 +31,10 @@ extern int32_t terminal_write (int32_t fd, const void* given_buf, int32_t length
 extern int32_t terminal_read (int32_t fd, void* given_buf, int32_t length);
 extern int32_t terminal_close (int32_t fd);
 extern int32_t switch_term(int32_t term_id);
-int32_t copy_to_terminal_buffer(char* key_buf, int32_t length);
+
+/* Line discipline, fed by the keyboard for the terminal on screen */
+extern void terminal_input(int32_t term, uint8_t c);
+extern void terminal_discard_line(int32_t term);
 void clear_screen();
 
 #endif
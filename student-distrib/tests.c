@@ -8,6 +8,8 @@
 //#include "terminal.h"
 //#include "keyboard.h"
 #include "system_calls.h"
+#include "sched.h"
+#include "lock.h"
 #define PASS 1
 #define FAIL 0
 
@@ -447,6 +449,78 @@ void test_terminal_read() {
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+/* Spinlock test
+ *
+ * Takes and releases an irqsave lock and checks ownership and the interrupt
+ * flag on the way, then runs the shells for a while and reports the longest
+ * stretch interrupts were kept off, by a lock, cli or an interrupt
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: prints the worst interrupts-off time in TSC cycles
+ * Coverage: spin_lock_irqsave, spin_unlock_irqrestore, irq-off tracking
+ * Files: lock.h/c
+ */
+int spinlock_test(){
+	TEST_HEADER;
+	static spinlock_t test_lock = SPINLOCK_INIT("test");
+	uint32_t flags, eflags, start;
+	int result = PASS;
+
+	flags = spin_lock_irqsave(&test_lock);
+	asm volatile("pushfl; popl %0" : "=r"(eflags));
+	if(!spin_is_held(&test_lock) || (eflags & EFLAGS_IF)){
+		result = FAIL;
+	}
+	spin_unlock_irqrestore(&test_lock, flags);
+	asm volatile("pushfl; popl %0" : "=r"(eflags));
+	if(spin_is_held(&test_lock) || (eflags & EFLAGS_IF) != (flags & EFLAGS_IF)){
+		result = FAIL;
+	}
+
+	// type in the shells meanwhile so term_lock and page_lock see some use
+	irq_off_max = 0;
+	start = sched_clock();
+	while(sched_clock() - start < PIT_FREQ * 5);
+	printf("longest irq-off section: %u cycles (%s)\n", irq_off_max,
+		irq_off_max_lock != NULL ? irq_off_max_lock : "none");
+
+	return result;
+}
+
+/* Signal test
+ *
+ * Checks that the hw_context_t offsets the assembly uses match the struct,
+ * then sends SIG_USER1 to the current process with no handler installed,
+ * which the default action ignores
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: none
+ * Coverage: hw_context_t layout, send_signal, signal_work
+ * Files: signal.h/c, int_wrapper.S
+ */
+int signal_test(){
+	TEST_HEADER;
+	hw_context_t ctx;
+	int result = PASS;
+
+	if((uint32_t)&ctx.ebx - (uint32_t)&ctx != HW_EBX
+		|| (uint32_t)&ctx.eax - (uint32_t)&ctx != HW_EAX
+		|| (uint32_t)&ctx.irqnum - (uint32_t)&ctx != HW_IRQNUM
+		|| (uint32_t)&ctx.errcode - (uint32_t)&ctx != HW_ERRCODE
+		|| (uint32_t)&ctx.eip - (uint32_t)&ctx != HW_EIP
+		|| (uint32_t)&ctx.cs - (uint32_t)&ctx != HW_CS
+		|| (uint32_t)&ctx.eflags - (uint32_t)&ctx != HW_EFLAGS
+		|| (uint32_t)&ctx.esp - (uint32_t)&ctx != HW_ESP
+		|| (uint32_t)&ctx.ss - (uint32_t)&ctx != HW_SS){
+		result = FAIL;
+	}
+
+	send_signal(cur_pid, SIG_USER1);
+	if(!(signal_work & (1 << cur_pid)) || signal_fatal_pending(cur_pid)){
+		result = FAIL;
+	}
+	return result;
+}
 
 /* Test suite entry point */
 void launch_tests(){
@@ -461,4 +535,6 @@ void launch_tests(){
 	//test_terminal_write();
 	//rtc_test1();
 	//rtc_test2(32);
+	//TEST_OUTPUT("spinlock_test", spinlock_test());
+	//TEST_OUTPUT("signal_test", signal_test());
 }
@@ -13,4 +13,6 @@ void test_terminal_write();
 void test_terminal_read();
 void rtc_test1();
 void rtc_test2(int freq);
+int spinlock_test();
+int signal_test();
 #endif /* TESTS_H */
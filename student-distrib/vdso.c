@@ -0,0 +1,165 @@
+#include "vdso.h"
+#include "paging.h"
+#include "sched.h"
+#include "rtc.h"
+#include "signal.h"
+#include "system_calls_asm.h"
+
+// a whole page so nothing else in kernel memory becomes readable through the mapping
+static uint8_t vdso_page[FOUR_KB] __attribute__((aligned (FOUR_KB)));
+vdso_data_t* const vdso = (vdso_data_t*)vdso_page;
+
+/* void vdso_write_begin();
+ * Inputs: void
+ * Return Value: none
+ * Function: Makes seq odd so readers retry until vdso_write_end. Writers run
+ *           with interrupts off, so they never overlap on one processor */
+static void vdso_write_begin(){
+    vdso->seq++;
+    asm volatile("" : : : "memory");
+}
+
+/* void vdso_write_end();
+ * Inputs: void
+ * Return Value: none
+ * Function: Makes seq even again, the fields are consistent */
+static void vdso_write_end(){
+    asm volatile("" : : : "memory");
+    vdso->seq++;
+}
+
+/* void vdso_init();
+ * Inputs: void
+ * Return Value: none
+ * Function: Maps the page read-only at VDSO_ADDR for every process, copies in
+ *           the sigreturn trampoline and the system call entry and takes the first
+ *           RTC reading. Runs after PIT_init so sched_clock works */
+void vdso_init(){
+    uint32_t flags;
+
+    memcpy(vdso_page + VDSO_SIGRETURN, sigreturn_trampoline,
+        sigreturn_trampoline_end - sigreturn_trampoline);
+    // without sysenter it would be #UD, sysenter_init left the MSRs alone
+    if(cpuid_features() & CPUID_SEP){
+        memcpy(vdso_page + VDSO_SYSCALL, vdso_sysenter, vdso_sysenter_end - vdso_sysenter);
+        vdso->sysenter = 1;
+    }
+    else{
+        memcpy(vdso_page + VDSO_SYSCALL, vdso_int80, vdso_int80_end - vdso_int80);
+    }
+    map_vdso_page((uint32_t)vdso_page);
+    vdso_set_time_of_day(rtc_time_of_day());
+
+    cli_and_save(flags);
+    vdso_tick(sched_clock(), timer_interrupts);
+    restore_flags(flags);
+}
+
+/* void vdso_set_clock(uint64_t base, uint32_t mult);
+ * Inputs: base - TSC at calibration
+ *         mult - PIT cycles per TSC cycle scaled by 2^32
+ * Return Value: none
+ * Function: Publishes what user space needs to compute sched_clock itself */
+void vdso_set_clock(uint64_t base, uint32_t mult){
+    vdso_write_begin();
+    vdso->tsc_base_lo = (uint32_t)base;
+    vdso->tsc_base_hi = (uint32_t)(base >> 32);
+    vdso->tsc_mult = mult;
+    vdso->pit_freq = PIT_FREQ;
+    vdso_write_end();
+}
+
+/* void vdso_tick(uint32_t now, uint32_t ticks);
+ * Inputs: now - sched_clock()
+ *         ticks - timer interrupts taken so far
+ * Return Value: none
+ * Function: Updates the tick count, call with interrupts disabled */
+void vdso_tick(uint32_t now, uint32_t ticks){
+    vdso_write_begin();
+    vdso->ticks = ticks;
+    vdso->clock = now;
+    vdso_write_end();
+}
+
+/* void vdso_set_time_of_day(uint32_t seconds);
+ * Inputs: seconds - RTC time of day, seconds since midnight
+ * Return Value: none
+ * Function: Stores the reading with the current sched_clock so readers can
+ *           add the time that passed since */
+void vdso_set_time_of_day(uint32_t seconds){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    vdso_write_begin();
+    vdso->wall_seconds = seconds;
+    vdso->wall_clock = sched_clock();
+    vdso_write_end();
+    restore_flags(flags);
+}
+
+/* void vdso_set_idle(uint32_t idle);
+ * Inputs: idle - idle_time after an idle period ended
+ * Return Value: none
+ * Function: Publishes the idle-time accounting, call with interrupts disabled */
+void vdso_set_idle(uint32_t idle){
+    vdso_write_begin();
+    vdso->idle_time = idle;
+    vdso_write_end();
+}
+
+/* void vdso_set_wake_latency(uint32_t latency);
+ * Inputs: latency - TSC cycles from sched_wake_term until the reader ran
+ * Return Value: none
+ * Function: Publishes one wakeup latency sample, call with interrupts disabled */
+void vdso_set_wake_latency(uint32_t latency){
+    vdso_write_begin();
+    vdso->wake_latency = latency;
+    vdso->wake_count++;
+    vdso_write_end();
+}
+
+/* void vdso_set_switch_latency(uint32_t latency);
+ * Inputs: latency - TSC cycles a switch to a running terminal took
+ * Return Value: none
+ * Function: Publishes one terminal switch latency sample */
+void vdso_set_switch_latency(uint32_t latency){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    vdso_write_begin();
+    vdso->switch_latency = latency;
+    vdso->switch_count++;
+    vdso_write_end();
+    restore_flags(flags);
+}
+
+/* void vdso_set_irq_off_max(uint32_t cycles, const char* where);
+ * Inputs: cycles - new longest interrupts-off section
+ *         where - what kept interrupts off, cut to fit irq_off_where
+ * Return Value: none
+ * Function: Publishes irq_off_max, call with interrupts disabled */
+void vdso_set_irq_off_max(uint32_t cycles, const char* where){
+    int32_t i;
+
+    vdso_write_begin();
+    vdso->irq_off_max = cycles;
+    for(i = 0; i < IRQ_OFF_WHERE_LEN - 1 && where != NULL && where[i] != '\0'; i++){
+        vdso->irq_off_where[i] = where[i];
+    }
+    vdso->irq_off_where[i] = '\0';
+    vdso_write_end();
+}
+
+/* void vdso_set_vga_port_writes(uint32_t writes);
+ * Inputs: writes - vga_port_writes after a CRTC register changed
+ * Return Value: none
+ * Function: Publishes the count of VGA port writes */
+void vdso_set_vga_port_writes(uint32_t writes){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    vdso_write_begin();
+    vdso->vga_port_writes = writes;
+    vdso_write_end();
+    restore_flags(flags);
+}
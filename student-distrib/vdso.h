@@ -0,0 +1,29 @@
+#ifndef _VDSO_H
+#define _VDSO_H
+
+#include "types.h"
+#include "vdso_data.h"
+
+// the shared page as the kernel writes it
+extern vdso_data_t* const vdso;
+
+// maps the page for user space and records the RTC time of day
+extern void vdso_init();
+// publishes the TSC calibration from PIT_init
+extern void vdso_set_clock(uint64_t base, uint32_t mult);
+// called from the timer interrupt with sched_clock() and the interrupt count
+extern void vdso_tick(uint32_t now, uint32_t ticks);
+// stores an RTC reading, taken now
+extern void vdso_set_time_of_day(uint32_t seconds);
+// publishes idle_time, call with interrupts disabled
+extern void vdso_set_idle(uint32_t idle);
+// publishes a keyboard wakeup latency, call with interrupts disabled
+extern void vdso_set_wake_latency(uint32_t latency);
+// publishes a terminal switch latency
+extern void vdso_set_switch_latency(uint32_t latency);
+// publishes a new irq_off_max, call with interrupts disabled
+extern void vdso_set_irq_off_max(uint32_t cycles, const char* where);
+// publishes vga_port_writes
+extern void vdso_set_vga_port_writes(uint32_t writes);
+
+#endif /* _VDSO_H */
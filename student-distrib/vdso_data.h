@@ -0,0 +1,62 @@
+#ifndef _VDSO_DATA_H
+#define _VDSO_DATA_H
+
+/*
+    Read-only page the kernel maps into every process at VDSO_ADDR so time
+    can be read without a system call. Shared with ../syscalls, so nothing
+    here may depend on kernel headers: the includer provides uint32_t.
+
+    The kernel bumps seq before and after every update, readers retry while
+    seq is odd or changed under them. Time since boot in PIT cycles is
+    computed the same way as sched_clock: take the TSC minus tsc_base and
+    scale it by tsc_mult / 2^32.
+*/
+
+// page directory entry 34, just above the vidmap page at 132MB
+#define VDSO_ADDR 0x8800000
+// offset in the page of the code signal handlers return to, it calls sigreturn
+#define VDSO_SIGRETURN 0x800
+// offset of the system call entry the ece391_* wrappers call: sysenter when the
+// processor has it, int 0x80 otherwise. Registers are the same as for int 0x80
+#define VDSO_SYSCALL 0x900
+// room for the name of the longest interrupts-off section, including the NUL
+#define IRQ_OFF_WHERE_LEN 32
+
+#ifndef __ASSEMBLER__
+typedef struct vdso_data{
+    volatile uint32_t seq;
+    // timer interrupts taken, the PIT is one-shot so this only counts deadlines
+    volatile uint32_t ticks;
+    // sched_clock() at the last update
+    volatile uint32_t clock;
+    // TSC calibration, see sched_clock
+    volatile uint32_t tsc_base_lo;
+    volatile uint32_t tsc_base_hi;
+    volatile uint32_t tsc_mult;
+    // PIT cycles per second, the unit of clock
+    volatile uint32_t pit_freq;
+    // RTC time of day in seconds since midnight, read at clock value wall_clock
+    volatile uint32_t wall_seconds;
+    volatile uint32_t wall_clock;
+    // PIT cycles spent in the idle task, updated each time it hands the CPU back
+    volatile uint32_t idle_time;
+    // TSC cycles from the last keyboard wakeup until its reader ran, and how
+    // many wakeups have been timed
+    volatile uint32_t wake_latency;
+    volatile uint32_t wake_count;
+    // TSC cycles the last switch to a running terminal took, and how many
+    // switches have been timed
+    volatile uint32_t switch_latency;
+    volatile uint32_t switch_count;
+    // longest stretch the kernel kept interrupts off, in TSC cycles
+    volatile uint32_t irq_off_max;
+    // the lock, interrupt handler or file:line of the cli that section started at
+    volatile uint8_t irq_off_where[IRQ_OFF_WHERE_LEN];
+    // 1 if the entry at VDSO_SYSCALL uses sysenter
+    volatile uint32_t sysenter;
+    // bytes written to the VGA CRTC ports to move the cursor or the display start
+    volatile uint32_t vga_port_writes;
+} vdso_data_t;
+#endif /* __ASSEMBLER__ */
+
+#endif /* _VDSO_DATA_H */
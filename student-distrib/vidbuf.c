@@ -0,0 +1,204 @@
+#include "vidbuf.h"
+#include "system_calls.h"
+#include "sched.h"
+#include "softirq.h"
+
+#define VIDBUF_PERIOD	(PIT_FREQ / VIDBUF_HZ)
+#define VIDBUF_CELLS	(SCR_WIDTH * SCR_HEIGHT)
+
+/* back buffer of each process, a page of RAM mapped where vidmap puts text memory */
+static uint16_t back_buffers[MAX_PCBS][FOUR_KB / 2] __attribute__((aligned (FOUR_KB)));
+/* what each back buffer last put on the screen, rows that differ are dirty */
+static uint16_t shown[MAX_PCBS][VIDBUF_CELLS];
+
+uint32_t vidbuf_deadline = 0;
+uint32_t vidbuf_clients = 0;
+
+/*
+ * row_differs
+ * DESCRIPTION: Compares a row of the back buffer with what is on screen
+ * INPUT: a, b - first cell of the two rows
+ * OUTPUT: n/a
+ * RETURNS: 1 if any cell differs, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+static int32_t row_differs (const uint16_t* a, const uint16_t* b) {
+	const uint32_t* x = (const uint32_t*)a;
+	const uint32_t* y = (const uint32_t*)b;
+	int32_t i;
+
+	for(i = 0; i < SCR_WIDTH / 2; i++){
+		if(x[i] != y[i])
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * vidbuf_present
+ * DESCRIPTION: Copies the rows of a back buffer that changed since its last
+ * 				present into the terminal's screen. The page's dirty bit says
+ * 				whether the program wrote anything at all, so an idle program
+ * 				costs one page table check
+ * INPUT: pid - buffered vidmap client
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: writes text memory, the screen is pinned at row 0 while mapped
+ */
+static void vidbuf_present (int32_t pid) {
+	int32_t row;
+	uint32_t flags;
+	uint16_t* back = back_buffers[pid];
+	uint16_t* last = shown[pid];
+	uint16_t* screen;
+
+	if(pcb_ptr_array[pid] == NULL || !vidmap_buffer_dirty(pid))
+		return;
+
+	screen = (uint16_t*)TERM_VID_ADDR(pcb_ptr_array[pid]->term_id);
+	flags = spin_lock_irqsave(&term_lock);
+	for(row = 0; row < SCR_HEIGHT * SCR_WIDTH; row += SCR_WIDTH){
+		if(row_differs(back + row, last + row)){
+			memcpy(screen + row, back + row, SCR_WIDTH * 2);
+			memcpy(last + row, back + row, SCR_WIDTH * 2);
+		}
+	}
+	spin_unlock_irqrestore(&term_lock, flags);
+}
+
+/*
+ * vidbuf_softirq
+ * DESCRIPTION: Timed present of every VIDBUF_AUTO client
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: see vidbuf_present
+ */
+static void vidbuf_softirq (void) {
+	int32_t i;
+
+	for(i = 0; i < MAX_PCBS; i++){
+		if(pcb_ptr_array[i] != NULL && pcb_ptr_array[i]->vidmap_buffered == VIDBUF_AUTO)
+			vidbuf_present(i);
+	}
+}
+
+/*
+ * vidmap_buffered_c (uint8_t** screen_start)
+ * DESCRIPTION: Maps a back buffer in RAM at the address vidmap uses. The
+ * 				program draws into it at memory speed and the kernel copies the
+ * 				rows that changed to the screen, VIDBUF_HZ times a second or
+ * 				only on vidmap_present once the program has called it. The
+ * 				buffer starts out as a copy of the screen
+ * INPUT: screen_start - where to store the address of the buffer
+ * OUTPUT: n/a
+ * RETURNS: -1 for a bad pointer, 0 on success
+ * SIDE EFFECTS: pins the terminal's screen like vidmap
+ */
+int32_t vidmap_buffered_c (uint8_t** screen_start) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	uint32_t flags;
+
+	if((uint32_t)screen_start < MB128 || (uint32_t)screen_start > MB132)
+		return -1;
+
+	if(pcb->vidmap_ptr == NULL)
+		screen_pin(pcb->term_id, 1);
+
+	if(pcb->vidmap_buffered == VIDBUF_OFF){
+		flags = spin_lock_irqsave(&term_lock);
+		memcpy(back_buffers[cur_pid], (uint16_t*)TERM_VID_ADDR(pcb->term_id), VIDBUF_CELLS * 2);
+		spin_unlock_irqrestore(&term_lock, flags);
+		memcpy(shown[cur_pid], back_buffers[cur_pid], VIDBUF_CELLS * 2);
+
+		// the PIT handler looks at the clients
+		cli_and_save(flags);
+		pcb->vidmap_buffered = VIDBUF_AUTO;
+		if(vidbuf_clients++ == 0)
+			vidbuf_deadline = sched_clock() + VIDBUF_PERIOD;
+		restore_flags(flags);
+	}
+
+	*screen_start = vidmap_buffer_init(cur_pid, (uint32_t)back_buffers[cur_pid]);
+	pcb->vidmap_ptr = *screen_start;
+	return 0;
+}
+
+/*
+ * vidmap_present_c (void)
+ * DESCRIPTION: Puts the back buffer on the screen now. The first call stops
+ * 				the timed presents, so a half drawn frame is never shown
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: -1 if the process has no back buffer, 0 on success
+ * SIDE EFFECTS: see vidbuf_present
+ */
+int32_t vidmap_present_c (void) {
+	pcb_t* pcb = pcb_ptr_array[cur_pid];
+	uint32_t flags;
+
+	if(pcb->vidmap_buffered == VIDBUF_OFF)
+		return -1;
+
+	cli_and_save(flags);
+	if(pcb->vidmap_buffered == VIDBUF_AUTO){
+		pcb->vidmap_buffered = VIDBUF_MANUAL;
+		vidbuf_clients--;
+	}
+	restore_flags(flags);
+
+	vidbuf_present(cur_pid);
+	return 0;
+}
+
+/*
+ * vidbuf_tick (uint32_t now)
+ * DESCRIPTION: Starts the timed presents once their deadline passes, the
+ * 				copying runs later in the softirq
+ * INPUT: now - sched_clock()
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: moves vidbuf_deadline, called with interrupts disabled
+ */
+void vidbuf_tick (uint32_t now) {
+	if(vidbuf_clients != 0 && (int32_t)(now - vidbuf_deadline) >= 0){
+		vidbuf_deadline = now + VIDBUF_PERIOD;
+		raise_softirq(SOFTIRQ_VIDBUF);
+	}
+}
+
+/*
+ * vidbuf_release (int32_t pid)
+ * DESCRIPTION: Presents what is left in a back buffer and stops buffering.
+ * 				The caller unmaps or remaps the page and handles the pin
+ * INPUT: pid - process giving up its back buffer
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: see vidbuf_present
+ */
+void vidbuf_release (int32_t pid) {
+	pcb_t* pcb = pcb_ptr_array[pid];
+	uint32_t flags;
+
+	if(pcb->vidmap_buffered == VIDBUF_OFF)
+		return;
+
+	vidbuf_present(pid);
+	cli_and_save(flags);
+	if(pcb->vidmap_buffered == VIDBUF_AUTO)
+		vidbuf_clients--;
+	pcb->vidmap_buffered = VIDBUF_OFF;
+	restore_flags(flags);
+}
+
+/*
+ * vidbuf_init (void)
+ * DESCRIPTION: Installs the softirq that does the timed presents
+ * INPUT: none
+ * OUTPUT: n/a
+ * RETURNS: none
+ * SIDE EFFECTS: none
+ */
+void vidbuf_init (void) {
+	open_softirq(SOFTIRQ_VIDBUF, vidbuf_softirq);
+}
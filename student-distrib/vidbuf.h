@@ -0,0 +1,32 @@
+#ifndef _VIDBUF_H
+#define _VIDBUF_H
+
+#include "types.h"
+
+/* pcb_t.vidmap_buffered, how a vidmap back buffer gets to the screen */
+#define VIDBUF_OFF		0
+/* copied on a timer until the program first calls vidmap_present */
+#define VIDBUF_AUTO		1
+/* copied only when the program calls vidmap_present */
+#define VIDBUF_MANUAL	2
+
+/* timed presents per second for VIDBUF_AUTO clients */
+#define VIDBUF_HZ		60
+
+/* sched_clock() time of the next timed present, used while vidbuf_clients is nonzero */
+extern uint32_t vidbuf_deadline;
+/* processes in VIDBUF_AUTO mode */
+extern uint32_t vidbuf_clients;
+
+/* like vidmap, but maps a RAM back buffer the kernel copies to the screen */
+extern int32_t vidmap_buffered_c (uint8_t** screen_start);
+/* copies the rows of the back buffer that changed to the screen */
+extern int32_t vidmap_present_c (void);
+/* called by the PIT handler, raises the present softirq once vidbuf_deadline passes */
+extern void vidbuf_tick (uint32_t now);
+/* presents a last time and goes back to unbuffered, used by halt and vidmap */
+extern void vidbuf_release (int32_t pid);
+/* installs the present softirq */
+extern void vidbuf_init (void);
+
+#endif /* _VIDBUF_H */
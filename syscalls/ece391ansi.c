@@ -0,0 +1,111 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Escape sequence demo, "ansi". Draws a header that stays put while numbered
+ * lines scroll under it in a scroll region, a row of colors, and a counter
+ * that is redrawn in place with a cursor move instead of a new line. Then
+ * maps the screen with vidmap, checks the cells against what the sequences
+ * should have drawn and prints PASS or FAIL.
+ */
+
+#define LINES 40
+#define COUNT 500
+#define NUMSIZE 12
+#define NUM_COLS 80
+/* VGA colors of ANSI red and yellow */
+#define VGA_RED 4
+#define VGA_BROWN 6
+
+static void
+put (const char* s)
+{
+    ece391_fdputs (1, (uint8_t*)s);
+}
+
+static void
+put_num (uint32_t n)
+{
+    uint8_t buf[NUMSIZE];
+
+    ece391_itoa (n, buf, 10);
+    ece391_fdputs (1, buf);
+}
+
+/* character and attribute at row, col of the mapped screen */
+#define CHAR_AT(screen, row, col) ((screen)[((row) * NUM_COLS + (col)) * 2])
+#define ATTR_AT(screen, row, col) ((screen)[((row) * NUM_COLS + (col)) * 2 + 1])
+
+/* 1 if the text at row, col of the screen is s */
+static int32_t
+text_at (uint8_t* screen, int32_t row, int32_t col, const char* s)
+{
+    int32_t i;
+
+    for (i = 0; s[i] != '\0'; i++) {
+        if (CHAR_AT (screen, row, col + i) != (uint8_t)s[i])
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * Checks what was drawn: the reverse video header survived the scrolling
+ * under it, lines 20 to 40 fill the region with an empty row below, red
+ * is red and the counter was redrawn in place in yellow.
+ */
+static int32_t
+check_screen (uint8_t* screen)
+{
+    return CHAR_AT (screen, 0, 1) == 'a'
+        && ATTR_AT (screen, 0, 1) != ATTR_AT (screen, 3, 0)
+        && text_at (screen, 1, 28, "red")
+        && (ATTR_AT (screen, 1, 28) & 0x0F) == VGA_RED
+        && text_at (screen, 1, 59, "count 500 ")
+        && (ATTR_AT (screen, 1, 59) & 0x0F) == VGA_BROWN
+        && text_at (screen, 3, 0, "line 20 ")
+        && text_at (screen, 23, 0, "line 40 ")
+        && text_at (screen, 24, 0, "    ");
+}
+
+int main ()
+{
+    uint32_t i;
+    int32_t ok;
+    uint8_t* screen;
+    uint8_t color[] = "\033[40m  ";
+
+    /* clear the screen and draw the header in reverse video */
+    put ("\033[2J\033[H\033[7m ansi: scroll region below, counter on the right \033[0m\n");
+
+    /* the eight background colors */
+    for (i = 0; i < 8; i++) {
+        color[3] = '0' + i;
+        put ((char*)color);
+    }
+    put ("\033[0m \033[1;32mbold green\033[0m \033[31mred\033[0m \033[94mbright blue\033[0m");
+
+    /* rows 4 to 25 scroll, the header and colors stay */
+    put ("\033[4;25r\033[4;1H");
+    for (i = 1; i <= LINES; i++) {
+        put ("line ");
+        put_num (i);
+        put ("\n");
+    }
+
+    /* redraw only the counter's cells */
+    for (i = 0; i <= COUNT; i++) {
+        put ("\033[s\033[2;60H\033[K\033[33mcount ");
+        put_num (i);
+        put ("\033[0m\033[u");
+    }
+
+    ok = -1 != ece391_vidmap (&screen) && check_screen (screen);
+
+    /* give the whole screen back to the shell */
+    put ("\033[r\033[25;1H\n");
+    put (ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}
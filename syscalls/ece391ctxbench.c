@@ -0,0 +1,54 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Context switch benchmark. "ctxbench" times yield when nothing else is
+ * runnable (the no-switch fast path). "ctxbench 2" is started on two
+ * terminals: each copy waits in a shared memory segment until the other is
+ * running too, then every yield hands the CPU to the other copy, so the two
+ * play ping-pong and every call costs one full switch there and back.
+ */
+
+#define ROUNDS 10000
+#define BUFSIZE 16
+#define CTX_KEY 0x43545842
+#define PAIR 2
+
+int main ()
+{
+    int32_t i, id;
+    uint32_t start, cycles;
+    uint8_t buf[BUFSIZE];
+    volatile uint32_t* ready;
+
+    if (0 == ece391_getargs (buf, BUFSIZE) && '0' + PAIR == buf[0]) {
+        id = ece391_shm_create (CTX_KEY, SHM_PAGE_SIZE);
+        ready = (volatile uint32_t*)(-1 == id ? -1 : ece391_shm_attach (id, 0));
+        if ((volatile uint32_t*)-1 == ready) {
+            ece391_fdputs (1, (uint8_t*)"can't attach the shared segment\n");
+            return 2;
+        }
+        /* start barrier: count ourselves in, wait for the other copy */
+        asm volatile ("lock incl %0" : "+m"(*ready));
+        ece391_fdputs (1, (uint8_t*)"waiting for the other copy\n");
+        while (*ready < PAIR)
+            ece391_yield ();
+    }
+
+    /* warm up the caches before timing */
+    ece391_yield ();
+
+    start = ece391_rdtsc ();
+    for (i = 0; i < ROUNDS; i++)
+        ece391_yield ();
+    cycles = ece391_rdtsc () - start;
+
+    ece391_fdputs (1, (uint8_t*)"yield: ");
+    ece391_itoa (cycles / ROUNDS, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" cycles per call\n");
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Framebuffer test, "fbtest". Switches to 1024x768, draws eight color bars
+ * with fb_fill, a gray ramp with fb_blit and a diagonal line straight into the
+ * mapped pixels, then reads pixels back to check them. The picture stays up
+ * for HOLD_MS so it can be captured headless from the QEMU monitor with
+ * "screendump fb.ppm". Then it times full screen fills and row blits, and
+ * halting puts the terminal back in text mode where the results show.
+ */
+
+#define WIDTH 1024
+#define HEIGHT 768
+#define BARS 8
+#define RAMP_Y 600
+#define RAMP_H 100
+#define HOLD_MS 5000
+#define NUMSIZE 12
+#define REPS 50
+
+static const uint32_t colors[BARS] = {
+    0x000000, 0xFF0000, 0x00FF00, 0x0000FF,
+    0xFFFF00, 0xFF00FF, 0x00FFFF, 0xFFFFFF
+};
+
+static uint32_t ramp[WIDTH];
+
+static int32_t
+check (fb_info_t* info, uint32_t x, uint32_t y, uint32_t want)
+{
+    uint32_t got = info->pixels[y * (info->pitch / 4) + x];
+    uint8_t buf[NUMSIZE];
+
+    if (got == want)
+        return 0;
+    ece391_fdputs (1, (uint8_t*)"pixel ");
+    ece391_itoa (x, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)",");
+    ece391_itoa (y, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" is ");
+    ece391_itoa (got, buf, 16);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 1;
+}
+
+static void
+report (const char* name, uint32_t ms)
+{
+    uint8_t buf[NUMSIZE];
+
+    if (ms == 0)
+        ms = 1;
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (REPS, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" screens in ");
+    ece391_itoa (ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" ms, ");
+    ece391_itoa (REPS * (WIDTH * HEIGHT * 4 / 1024) / 1024 * 1000 / ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" MB/s\n");
+}
+
+int main ()
+{
+    fb_info_t info;
+    fb_rect_t rect;
+    uint32_t i, rep, start, fill, blit;
+    int32_t bad = 0;
+
+    if (-1 == ece391_fb_map (WIDTH, HEIGHT, &info)) {
+        ece391_fdputs (1, (uint8_t*)"no VBE framebuffer\n");
+        return 2;
+    }
+
+    rect.y = 0;
+    rect.width = WIDTH / BARS;
+    rect.height = RAMP_Y;
+    for (i = 0; i < BARS; i++) {
+        rect.x = i * rect.width;
+        ece391_fb_fill (&rect, colors[i]);
+    }
+
+    for (i = 0; i < WIDTH; i++) {
+        uint32_t v = i * 256 / WIDTH;
+        ramp[i] = (v << 16) | (v << 8) | v;
+    }
+    rect.x = 0;
+    rect.y = RAMP_Y;
+    rect.width = WIDTH;
+    rect.height = RAMP_H;
+    rect.src = ramp;
+    rect.src_pitch = WIDTH;
+    /* every row of the ramp comes from the same source row */
+    for (i = 0; i < RAMP_H; i++) {
+        rect.y = RAMP_Y + i;
+        rect.height = 1;
+        ece391_fb_blit (&rect);
+    }
+
+    for (i = 0; i < HEIGHT; i++)
+        info.pixels[i * (info.pitch / 4) + i * WIDTH / HEIGHT] = 0xFF8000;
+
+    for (i = 0; i < BARS; i++)
+        bad += check (&info, i * (WIDTH / BARS) + WIDTH / BARS / 2, RAMP_Y / 4, colors[i]);
+    bad += check (&info, WIDTH - 1, RAMP_Y + RAMP_H / 2, ramp[WIDTH - 1]);
+    bad += check (&info, 0, 0, 0xFF8000);
+
+    start = ece391_time_ms ();
+    while (ece391_time_ms () - start < HOLD_MS)
+        ece391_yield ();
+
+    rect.x = 0;
+    rect.y = 0;
+    rect.width = WIDTH;
+    rect.height = HEIGHT;
+    start = ece391_time_ms ();
+    for (rep = 0; rep < REPS; rep++)
+        ece391_fb_fill (&rect, colors[rep % BARS]);
+    fill = ece391_time_ms () - start;
+
+    rect.height = 1;
+    start = ece391_time_ms ();
+    for (rep = 0; rep < REPS; rep++) {
+        for (i = 0; i < HEIGHT; i++) {
+            rect.y = i;
+            ece391_fb_blit (&rect);
+        }
+    }
+    blit = ece391_time_ms () - start;
+
+    report ("fb_fill: ", fill);
+    report ("fb_blit, one row per call: ", blit);
+    ece391_fdputs (1, bad ? (uint8_t*)"fbtest FAIL\n" : (uint8_t*)"fbtest PASS\n");
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Idle accounting check. Run it with the other terminals sitting at a shell
+ * prompt. It sleeps on the RTC for a few seconds and reports how much of that
+ * time the kernel spent halted in its idle task and how many timer interrupts
+ * it took. An idle system should be nearly all idle, with the PIT firing only
+ * for our own RTC wakeups.
+ */
+
+#define SECONDS 5
+#define RTC_HZ 2
+#define MIN_IDLE_PERCENT 90
+#define BUFSIZE 16
+
+int main ()
+{
+    int32_t fd, i, rate = RTC_HZ, garbage;
+    uint32_t start, start_idle, start_ticks;
+    uint32_t total, idle, ticks, percent;
+    uint8_t buf[BUFSIZE];
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"rtc"))) {
+        ece391_fdputs (1, (uint8_t*)"can't open rtc\n");
+        return 2;
+    }
+    ece391_write (fd, &rate, 4);
+    // line up with the RTC before measuring
+    ece391_read (fd, &garbage, 4);
+
+    start = ece391_clock ();
+    start_idle = ece391_idle_time ();
+    start_ticks = ece391_ticks ();
+    for (i = 0; i < SECONDS * RTC_HZ; i++)
+        ece391_read (fd, &garbage, 4);
+    total = ece391_clock () - start;
+    idle = ece391_idle_time () - start_idle;
+    ticks = ece391_ticks () - start_ticks;
+    ece391_close (fd);
+
+    percent = idle / (total / 100);
+    ece391_fdputs (1, (uint8_t*)"idle: ");
+    ece391_itoa (percent, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)"%, timer interrupts: ");
+    ece391_itoa (ticks, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    // one wakeup per RTC period, a few spare for the shells and rounding
+    if (percent < MIN_IDLE_PERCENT || ticks > 2 * SECONDS * RTC_HZ) {
+        ece391_fdputs (1, (uint8_t*)"FAIL\n");
+        return 1;
+    }
+    ece391_fdputs (1, (uint8_t*)"PASS\n");
+    return 0;
+}
@@ -12,7 +12,93 @@
 #define STARTCHAR 'A'
 #define ENDCHAR 'Z'
 
-int main ()
+/*
+ * "pingpong ipc" times IPC round trips instead of bouncing letters. It
+ * runs "pingpong server | pingpong client": the server writes its pid
+ * into the pipe, then answers every call by adding one to the first
+ * word. The client makes ROUNDS calls with no buffer and ROUNDS with a
+ * BIGMSG byte one, and tells the server to quit with QUIT.
+ */
+#define ROUNDS 10000
+#define BIGMSG 256
+#define QUIT 0xFFFFFFFF
+#define ARGMAX 16
+
+static int
+server (void)
+{
+    uint8_t pidstr[ARGMAX];
+    uint8_t data[BIGMSG];
+    ipc_msg_t msg;
+    int32_t client;
+
+    ece391_itoa (ece391_getpid (), pidstr, 10);
+    ece391_write (1, pidstr, ece391_strlen (pidstr) + 1);
+
+    while (1) {
+	msg.buf = (uint32_t)data;
+	msg.len = BIGMSG;
+	if (-1 == (client = ece391_ipc_recv (IPC_ANY, &msg)))
+	    return 1;
+	if (QUIT == msg.words[0]) {
+	    ece391_ipc_send (client, &msg);
+	    return 0;
+	}
+	msg.words[0]++;
+	ece391_ipc_send (client, &msg);
+    }
+}
+
+static void
+time_calls (int32_t server_pid, const char* name, uint32_t len)
+{
+    uint8_t data[BIGMSG];
+    uint8_t buf[ARGMAX];
+    ipc_msg_t msg;
+    uint32_t start, cycles;
+    int32_t i;
+
+    msg.words[0] = 0;
+    start = ece391_rdtsc ();
+    for (i = 0; i < ROUNDS; i++) {
+	msg.buf = (uint32_t)data;
+	msg.len = len;
+	if (-1 == ece391_ipc_call (server_pid, &msg))
+	    break;
+    }
+    cycles = ece391_rdtsc () - start;
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (cycles / ROUNDS, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)(msg.words[0] == ROUNDS ? " cycles per round trip\n"
+				: " cycles per round trip, lost answers\n"));
+}
+
+static int
+client (void)
+{
+    uint8_t pidstr[ARGMAX];
+    ipc_msg_t msg;
+    int32_t server_pid = 0;
+    int32_t i;
+
+    if (0 >= ece391_read (0, pidstr, ARGMAX))
+	return 1;
+    for (i = 0; pidstr[i] >= '0' && pidstr[i] <= '9'; i++)
+	server_pid = server_pid * 10 + pidstr[i] - '0';
+
+    time_calls (server_pid, "ipc call: ", 0);
+    time_calls (server_pid, "ipc call, 256 byte buffer: ", BIGMSG);
+
+    msg.words[0] = QUIT;
+    msg.len = 0;
+    ece391_ipc_call (server_pid, &msg);
+    return 0;
+}
+
+static int
+bounce (void)
 {
     int32_t i = 0;
     int32_t j = 0;
@@ -87,3 +173,18 @@ int main ()
     }
     return 0;
 }
+
+int main ()
+{
+    uint8_t args[ARGMAX];
+
+    if (-1 == ece391_getargs (args, ARGMAX))
+	return bounce ();
+    if (0 == ece391_strcmp (args, (uint8_t*)"ipc"))
+	return ece391_execute ((uint8_t*)"pingpong server | pingpong client");
+    if (0 == ece391_strcmp (args, (uint8_t*)"server"))
+	return server ();
+    if (0 == ece391_strcmp (args, (uint8_t*)"client"))
+	return client ();
+    return bounce ();
+}
@@ -0,0 +1,99 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Pipe benchmark. Run with no arguments it first pushes data through a
+ * pipe inside one process, which only costs the copies, then runs
+ * "pipebench w | pipebench r": the writer sends TOTAL bytes in CHUNK
+ * sized writes and the reader times how long they take to come out.
+ */
+
+#define TOTAL (4 * 1024 * 1024)
+#define CHUNK 4096
+#define BUFSIZE 16
+
+static uint8_t data[CHUNK];
+
+static void
+report (const char* name, uint32_t bytes, uint32_t ms)
+{
+    uint8_t buf[BUFSIZE];
+
+    if (ms == 0)
+        ms = 1;
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (bytes, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" bytes in ");
+    ece391_itoa (ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" ms, ");
+    ece391_itoa ((bytes / 1024) * 1000 / ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" KB/s\n");
+}
+
+/* both ends in this process, each chunk is written and read straight back */
+static void
+single (void)
+{
+    int32_t fds[2];
+    uint32_t bytes, start;
+    int32_t cnt;
+
+    if (-1 == ece391_pipe (fds)) {
+        ece391_fdputs (1, (uint8_t*)"pipe failed\n");
+        return;
+    }
+    start = ece391_time_ms ();
+    for (bytes = 0; bytes < TOTAL; bytes += cnt) {
+        ece391_write (fds[1], data, CHUNK);
+        if (0 >= (cnt = ece391_read (fds[0], data, CHUNK)))
+            break;
+    }
+    report ("one process: ", bytes, ece391_time_ms () - start);
+    ece391_close (fds[0]);
+    ece391_close (fds[1]);
+}
+
+static void
+writer (void)
+{
+    uint32_t bytes;
+
+    for (bytes = 0; bytes < TOTAL; bytes += CHUNK) {
+        if (-1 == ece391_write (1, data, CHUNK))
+            break;
+    }
+}
+
+static void
+reader (void)
+{
+    uint32_t bytes = 0, start;
+    int32_t cnt;
+
+    start = ece391_time_ms ();
+    while (0 < (cnt = ece391_read (0, data, CHUNK)))
+        bytes += cnt;
+    report ("two processes: ", bytes, ece391_time_ms () - start);
+}
+
+int main ()
+{
+    uint8_t args[BUFSIZE];
+
+    if (-1 == ece391_getargs (args, BUFSIZE)) {
+        single ();
+        if (0 != ece391_execute ((uint8_t*)"pipebench w | pipebench r"))
+            ece391_fdputs (1, (uint8_t*)"pipeline failed\n");
+        return 0;
+    }
+    if (args[0] == 'w')
+        writer ();
+    else
+        reader ();
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Ring benchmark. Reads every file in the directory, grep style, once with
+ * a system call per open/read/close and once through the rings with one
+ * ring_enter per batch, and prints the cycles each pass took.
+ */
+
+#define MAX_FILES 20
+/* a process has 6 descriptors left after stdin and stdout */
+#define BATCH 6
+#define NAMESIZE 33
+#define CHUNK 1024
+#define BUFSIZE 16
+
+static uint8_t names[MAX_FILES][NAMESIZE];
+static int32_t fds[MAX_FILES];
+static uint8_t data[MAX_FILES][CHUNK];
+static ring_t ring;
+
+static void
+report (const char* name, uint32_t cycles, uint32_t bytes)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (cycles, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" cycles, ");
+    ece391_itoa (bytes, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" bytes\n");
+}
+
+/* runs everything queued and hands each result to fds[] or the byte count */
+static void
+drain (uint32_t* bytes, int32_t save_fds)
+{
+    ring_cqe_t* cqe;
+
+    ece391_ring_enter (ece391_ring_pending (&ring));
+    while (0 != (cqe = ece391_ring_cqe (&ring))) {
+        if (save_fds)
+            fds[cqe->user_data] = cqe->res;
+        else if (cqe->res > 0)
+            *bytes += cqe->res;
+        ece391_ring_cqe_seen (&ring);
+    }
+}
+
+int main ()
+{
+    int32_t dir, cnt, nfiles, i, first, last;
+    uint32_t start, bytes;
+
+    if (-1 == (dir = ece391_open ((uint8_t*)"."))) {
+        ece391_fdputs (1, (uint8_t*)"directory open failed\n");
+        return 2;
+    }
+    nfiles = 0;
+    while (nfiles < MAX_FILES && 0 < (cnt = ece391_read (dir, names[nfiles], NAMESIZE - 1))) {
+        names[nfiles][cnt] = '\0';
+        if ('.' != names[nfiles][0])
+            nfiles++;
+    }
+    ece391_close (dir);
+
+    if (-1 == ece391_ring_setup (&ring)) {
+        ece391_fdputs (1, (uint8_t*)"ring setup failed\n");
+        return 3;
+    }
+
+    /* one system call per operation */
+    bytes = 0;
+    start = ece391_rdtsc ();
+    for (i = 0; i < nfiles; i++) {
+        fds[i] = ece391_open (names[i]);
+        while (0 < (cnt = ece391_read (fds[i], data[i], CHUNK)))
+            bytes += cnt;
+        ece391_close (fds[i]);
+    }
+    report ("syscalls: ", ece391_rdtsc () - start, bytes);
+
+    /* per group of files: opens in one batch, reads for every file per batch, closes in one batch */
+    bytes = 0;
+    start = ece391_rdtsc ();
+    for (first = 0; first < nfiles; first += BATCH) {
+        last = first + BATCH < nfiles ? first + BATCH : nfiles;
+        for (i = first; i < last; i++)
+            ece391_ring_queue (&ring, RING_OP_OPEN, 0, names[i], 0, i);
+        drain (&bytes, 1);
+        do {
+            cnt = bytes;
+            for (i = first; i < last; i++)
+                if (-1 != fds[i])
+                    ece391_ring_queue (&ring, RING_OP_READ, fds[i], data[i], CHUNK, i);
+            drain (&bytes, 0);
+        } while (bytes != (uint32_t)cnt);
+        for (i = first; i < last; i++)
+            if (-1 != fds[i])
+                ece391_ring_queue (&ring, RING_OP_CLOSE, fds[i], 0, 0, i);
+        drain (&bytes, 0);
+    }
+    report ("rings:    ", ece391_rdtsc () - start, bytes);
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Scrollback check, "scrolltest". Prints numbered lines, the first half one
+ * write per line and the second half in a single long write, most of which
+ * scrolls past without ever reaching the screen. Paging back with
+ * Shift+PgUp should then show every line in order with none missing.
+ */
+
+#define LINES 200
+#define LINE_LEN 16
+#define NUMSIZE 12
+
+static uint8_t text[LINES / 2 * LINE_LEN];
+
+/* writes "line n\n" at buf and returns its length */
+static uint32_t
+make_line (uint8_t* buf, uint32_t n)
+{
+    uint32_t len;
+
+    ece391_strcpy (buf, (uint8_t*)"line ");
+    ece391_itoa (n, buf + 5, 10);
+    len = ece391_strlen (buf);
+    buf[len] = '\n';
+    return len + 1;
+}
+
+int main ()
+{
+    uint8_t buf[LINE_LEN];
+    uint8_t num[NUMSIZE];
+    uint32_t i, len;
+
+    for (i = 1; i <= LINES / 2; i++)
+        ece391_write (1, buf, make_line (buf, i));
+
+    len = 0;
+    for (i = LINES / 2 + 1; i <= LINES; i++)
+        len += make_line (text + len, i);
+    ece391_write (1, text, len);
+
+    ece391_itoa (LINES, num, 10);
+    ece391_fdputs (1, (uint8_t*)"Shift+PgUp should show line 1 to ");
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)" in order\n");
+    return 0;
+}
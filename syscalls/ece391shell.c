@@ -5,6 +5,28 @@
 
 #define BUFSIZE 1024
 
+/*
+ * "a | b" is run by execute, which sends a's output into b. Only one |
+ * is allowed and both sides need a command. Returns 1 if buf is fine.
+ */
+static int
+pipeline_ok (const uint8_t* buf)
+{
+    int32_t pipes = 0, left = 0, right = 0;
+
+    for (; '\0' != *buf; buf++) {
+	if ('|' == *buf)
+	    pipes++;
+	else if (' ' != *buf) {
+	    if (0 == pipes)
+		left = 1;
+	    else
+		right = 1;
+	}
+    }
+    return 0 == pipes || (1 == pipes && left && right);
+}
+
 int main ()
 {
     int32_t cnt, rval;
@@ -24,6 +46,10 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
+	if (!pipeline_ok (buf)) {
+	    ece391_fdputs (1, (uint8_t*)"usage: command | command\n");
+	    continue;
+	}
 	rval = ece391_execute (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
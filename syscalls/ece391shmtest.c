@@ -0,0 +1,71 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Shared memory test. The parent makes a segment, leaves a message in it
+ * and runs "shmtest child", which attaches the same segment somewhere
+ * else in its window, prints the message and answers in place. Nothing
+ * goes through a system call but the attach itself.
+ */
+
+#define KEY 391
+#define SIZE 8192
+#define MSG_SIZE 64
+#define BUFSIZE 16
+
+typedef struct shared {
+    uint8_t msg[MSG_SIZE];
+    uint8_t reply[MSG_SIZE];
+    /* the second page, to check a segment spans pages */
+    uint8_t pad[SHM_PAGE_SIZE];
+    uint32_t last_word;
+} shared_t;
+
+static int
+child (void)
+{
+    int32_t id;
+    shared_t* sh;
+
+    if (-1 == (id = ece391_shm_create (KEY, SIZE)))
+        return 2;
+    /* a different address than the parent's, the pages are the same */
+    sh = (shared_t*)ece391_shm_attach (id, (void*)(SHM_ADDR + 4 * SHM_PAGE_SIZE));
+    if ((shared_t*)-1 == sh)
+        return 2;
+    ece391_fdputs (1, (uint8_t*)"child read: ");
+    ece391_fdputs (1, sh->msg);
+    ece391_strcpy (sh->reply, (uint8_t*)"hello from the child\n");
+    sh->last_word = sh->last_word + 1;
+    ece391_shm_detach (sh);
+    return 0;
+}
+
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    int32_t id;
+    shared_t* sh;
+
+    if (0 == ece391_getargs (args, BUFSIZE))
+        return child ();
+
+    if (-1 == (id = ece391_shm_create (KEY, SIZE)) ||
+        (shared_t*)-1 == (sh = (shared_t*)ece391_shm_attach (id, 0))) {
+        ece391_fdputs (1, (uint8_t*)"shm setup failed\n");
+        return 2;
+    }
+    ece391_strcpy (sh->msg, (uint8_t*)"hello from the parent\n");
+    sh->last_word = 41;
+
+    if (0 != ece391_execute ((uint8_t*)"shmtest child"))
+        ece391_fdputs (1, (uint8_t*)"child failed\n");
+    ece391_fdputs (1, (uint8_t*)"parent read: ");
+    ece391_fdputs (1, sh->reply);
+    ece391_fdputs (1, (uint8_t*)(sh->last_word == 42 ? "PASS\n" : "FAIL\n"));
+
+    ece391_shm_detach (sh);
+    return 0;
+}
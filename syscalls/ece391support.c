@@ -2,6 +2,11 @@
 
 #include "ece391support.h"
 #include "ece391syscall.h"
+#include "../student-distrib/vdso_data.h"
+
+#define MS_PER_SEC 1000
+
+static const vdso_data_t* const vdso = (const vdso_data_t*)VDSO_ADDR;
 
 uint32_t ece391_strlen(const uint8_t* s)
 {
@@ -102,3 +107,173 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+/* The processor's time stamp counter, benchmarks keep the low half */
+uint64_t ece391_rdtsc(void)
+{
+    uint32_t lo, hi;
+
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return (((uint64_t)hi) << 32) | lo;
+}
+
+/*
+ * Time since boot in PIT cycles (ece391_clock_freq per second), the same
+ * value the kernel's sched_clock returns. Wraps after about an hour, so
+ * compare with (int32_t)(a - b).
+ */
+uint32_t ece391_clock(void)
+{
+    uint32_t seq, base_lo, base_hi, mult;
+    uint64_t tsc;
+
+    do {
+        seq = vdso->seq;
+        base_lo = vdso->tsc_base_lo;
+        base_hi = vdso->tsc_base_hi;
+        mult = vdso->tsc_mult;
+    } while ((seq & 1) || seq != vdso->seq);
+
+    tsc = ece391_rdtsc () - ((((uint64_t)base_hi) << 32) | base_lo);
+    return (uint32_t)((tsc >> 32) * mult + (((tsc & 0xFFFFFFFF) * mult) >> 32));
+}
+
+uint32_t ece391_clock_freq(void)
+{
+    return vdso->pit_freq;
+}
+
+/* Timer interrupts the kernel has taken */
+uint32_t ece391_ticks(void)
+{
+    return vdso->ticks;
+}
+
+/* PIT cycles the kernel has spent halted in its idle task */
+uint32_t ece391_idle_time(void)
+{
+    return vdso->idle_time;
+}
+
+/*
+ * TSC cycles the last keyboard wakeup took to reach its reader. *count is
+ * the number of wakeups timed so far, so a caller can tell a new sample.
+ */
+uint32_t ece391_wake_latency(uint32_t* count)
+{
+    uint32_t seq, latency;
+
+    do {
+        seq = vdso->seq;
+        latency = vdso->wake_latency;
+        *count = vdso->wake_count;
+    } while ((seq & 1) || seq != vdso->seq);
+
+    return latency;
+}
+
+/*
+ * TSC cycles the last switch to a running terminal took. *count is the
+ * number of switches timed so far.
+ */
+uint32_t ece391_switch_latency(uint32_t* count)
+{
+    uint32_t seq, latency;
+
+    do {
+        seq = vdso->seq;
+        latency = vdso->switch_latency;
+        *count = vdso->switch_count;
+    } while ((seq & 1) || seq != vdso->seq);
+
+    return latency;
+}
+
+/*
+ * Longest stretch the kernel kept interrupts off, in TSC cycles. Copies what
+ * kept them off into where, which must hold IRQ_OFF_WHERE_LEN bytes.
+ */
+uint32_t ece391_irq_off_max(uint8_t* where)
+{
+    uint32_t seq, cycles, i;
+
+    do {
+        seq = vdso->seq;
+        cycles = vdso->irq_off_max;
+        for (i = 0; i < IRQ_OFF_WHERE_LEN; i++)
+            where[i] = vdso->irq_off_where[i];
+    } while ((seq & 1) || seq != vdso->seq);
+
+    where[IRQ_OFF_WHERE_LEN - 1] = '\0';
+    return cycles;
+}
+
+/* Port writes the kernel has made to move the VGA cursor or display start */
+uint32_t ece391_vga_port_writes(void)
+{
+    return vdso->vga_port_writes;
+}
+
+/* 1 if the processor has sysenter and the wrappers use it */
+uint32_t ece391_has_sysenter(void)
+{
+    return vdso->sysenter;
+}
+
+uint32_t ece391_time_ms(void)
+{
+    return ece391_clock () / (vdso->pit_freq / MS_PER_SEC);
+}
+
+/* Seconds since midnight from the RTC, advanced by the clock since it was read */
+uint32_t ece391_time_of_day(void)
+{
+    uint32_t seq, seconds, read_at;
+
+    do {
+        seq = vdso->seq;
+        seconds = vdso->wall_seconds;
+        read_at = vdso->wall_clock;
+    } while ((seq & 1) || seq != vdso->seq);
+
+    return seconds + (ece391_clock () - read_at) / vdso->pit_freq;
+}
+
+/*
+ * Fills in the next submission slot and publishes it. Returns -1 if the
+ * submission ring is full, ece391_ring_enter has to run some first.
+ */
+int32_t ece391_ring_queue(ring_t* ring, uint32_t op, int32_t fd, void* buf, int32_t len, uint32_t user_data)
+{
+    ring_sqe_t* sqe;
+
+    if (ring->sq_tail - ring->sq_head == RING_ENTRIES)
+        return -1;
+    sqe = &ring->sq[ring->sq_tail & (RING_ENTRIES - 1)];
+    sqe->op = op;
+    sqe->fd = fd;
+    sqe->buf = (uint32_t)buf;
+    sqe->len = len;
+    sqe->user_data = user_data;
+    ring->sq_tail++;
+    return 0;
+}
+
+/* Requests queued but not yet run */
+int32_t ece391_ring_pending(ring_t* ring)
+{
+    return ring->sq_tail - ring->sq_head;
+}
+
+/* Oldest completion not yet seen, 0 if there is none */
+ring_cqe_t* ece391_ring_cqe(ring_t* ring)
+{
+    if (ring->cq_head == ring->cq_tail)
+        return 0;
+    return &ring->cq[ring->cq_head & (RING_ENTRIES - 1)];
+}
+
+/* Frees the completion ece391_ring_cqe returned */
+void ece391_ring_cqe_seen(ring_t* ring)
+{
+    ring->cq_head++;
+}
@@ -1,6 +1,8 @@
 #if !defined(ECE391SUPPORT_H)
 #define ECE391SUPPORT_H
 
+#include "../student-distrib/ring_data.h"
+
 extern uint32_t ece391_strlen(const uint8_t* s);
 extern void ece391_strcpy(uint8_t* dst, const uint8_t* src);
 extern void ece391_fdputs(int32_t fd, const uint8_t* s);
@@ -9,5 +11,25 @@ extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
 
+/* Time from the kernel's shared page, no system call involved */
+extern uint64_t ece391_rdtsc(void);
+extern uint32_t ece391_clock(void);
+extern uint32_t ece391_clock_freq(void);
+extern uint32_t ece391_ticks(void);
+extern uint32_t ece391_idle_time(void);
+extern uint32_t ece391_wake_latency(uint32_t* count);
+extern uint32_t ece391_switch_latency(uint32_t* count);
+extern uint32_t ece391_irq_off_max(uint8_t* where);
+extern uint32_t ece391_has_sysenter(void);
+extern uint32_t ece391_vga_port_writes(void);
+extern uint32_t ece391_time_ms(void);
+extern uint32_t ece391_time_of_day(void);
+
+/* Queue requests on rings registered with ece391_ring_setup */
+extern int32_t ece391_ring_queue(ring_t* ring, uint32_t op, int32_t fd, void* buf, int32_t len, uint32_t user_data);
+extern int32_t ece391_ring_pending(ring_t* ring);
+extern ring_cqe_t* ece391_ring_cqe(ring_t* ring);
+extern void ece391_ring_cqe_seen(ring_t* ring);
+
 #endif /* ECE391SUPPORT_H */
 
@@ -0,0 +1,72 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Terminal switch latency benchmark. Start a shell on terminals 2 and 3 and
+ * run cat on a long file or counter in them, then run this on terminal 1 and
+ * switch between the terminals with Alt+F1/F2/F3 SAMPLES times. The kernel
+ * times each switch to a running terminal; the average and worst case are
+ * printed at the end, on terminal 1.
+ */
+
+#define SAMPLES 20
+#define RTC_HZ 64
+#define NUMSIZE 16
+#define US_PER_SEC 1000000
+#define CALIBRATE_DIV 100
+
+int main ()
+{
+    int32_t fd, i, rate = RTC_HZ, garbage;
+    uint32_t start_clock, start_tsc, cycles_per_us;
+    uint32_t count, last_count, latency, total, max;
+    uint8_t buf[NUMSIZE];
+
+    // TSC cycles per microsecond, measured against 10 ms of the kernel clock
+    start_clock = ece391_clock ();
+    start_tsc = ece391_rdtsc ();
+    while (ece391_clock () - start_clock < ece391_clock_freq () / CALIBRATE_DIV);
+    cycles_per_us = ece391_rdtsc () - start_tsc;
+    cycles_per_us /= US_PER_SEC / CALIBRATE_DIV;
+    if (cycles_per_us == 0)
+        cycles_per_us = 1;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"rtc"))) {
+        ece391_fdputs (1, (uint8_t*)"can't open rtc\n");
+        return 2;
+    }
+    ece391_write (fd, &rate, 4);
+
+    ece391_fdputs (1, (uint8_t*)"switch terminals ");
+    ece391_itoa (SAMPLES, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" times\n");
+
+    total = 0;
+    max = 0;
+    ece391_switch_latency (&last_count);
+    for (i = 0; i < SAMPLES; ) {
+        // sleep instead of spinning so the other terminals keep running
+        ece391_read (fd, &garbage, 4);
+        latency = ece391_switch_latency (&count);
+        if (count == last_count)
+            continue;
+        last_count = count;
+        total += latency / cycles_per_us;
+        if (latency / cycles_per_us > max)
+            max = latency / cycles_per_us;
+        i++;
+    }
+    ece391_close (fd);
+
+    ece391_fdputs (1, (uint8_t*)"switch latency: avg ");
+    ece391_itoa (total / SAMPLES, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" us, max ");
+    ece391_itoa (max, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" us\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "ece391sysnum.h"
+
+/*
+ * System call entry/exit benchmark. Call number 0 is rejected by the kernel
+ * right after entry, so a null call is just the trip into the kernel and
+ * back. getargs and an empty write add the cost of the two cheapest real
+ * calls on top. Every call is timed through int 0x80/iret and, if the
+ * processor has it, through sysenter/sysexit.
+ */
+
+#define ROUNDS 10000
+#define BUFSIZE 16
+#define NULL_CALL 0
+#define ARGSIZE 32
+
+static void
+report (const char* name, const char* path, uint32_t cycles)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, (uint8_t*)path);
+    ece391_itoa (cycles / ROUNDS, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" cycles per call\n");
+}
+
+static void
+bench (const char* name, int32_t num, int32_t a, int32_t b, int32_t c)
+{
+    int32_t i;
+    uint32_t start;
+
+    // warm up the caches before timing
+    ece391_int80_call (num, a, b, c);
+
+    start = ece391_rdtsc ();
+    for (i = 0; i < ROUNDS; i++)
+        ece391_int80_call (num, a, b, c);
+    report (name, " int 0x80: ", ece391_rdtsc () - start);
+
+    if (!ece391_has_sysenter ())
+        return;
+    ece391_sysenter_call (num, a, b, c);
+
+    start = ece391_rdtsc ();
+    for (i = 0; i < ROUNDS; i++)
+        ece391_sysenter_call (num, a, b, c);
+    report (name, " sysenter: ", ece391_rdtsc () - start);
+}
+
+int main ()
+{
+    uint8_t args[ARGSIZE];
+
+    bench ("null", NULL_CALL, 0, 0, 0);
+    bench ("getargs", SYS_GETARGS, (int32_t)args, ARGSIZE, 0);
+    bench ("write 0", SYS_WRITE, 1, (int32_t)args, 0);
+
+    return 0;
+}
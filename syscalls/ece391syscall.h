@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+#include "../student-distrib/ring_data.h"
+#include "../student-distrib/shm_data.h"
+#include "../student-distrib/ipc_data.h"
+#include "../student-distrib/fb_data.h"
+
 /* All calls return >= 0 on success or -1 on failure. */
 
 /*  
@@ -21,6 +26,35 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_yield (void);
+/* which is a pid or -1 for the last child to exit, buf a sysstat_t */
+extern int32_t ece391_sysstat (int32_t which, void* buf, int32_t nbytes);
+/* see ring_data.h, returns how many queued requests ring_enter ran */
+extern int32_t ece391_ring_setup (ring_t* ring);
+extern int32_t ece391_ring_enter (uint32_t to_submit);
+/* fds[0] gets the read end, fds[1] the write end */
+extern int32_t ece391_pipe (int32_t fds[2]);
+/* see shm_data.h, attach returns the address the segment got or -1 */
+extern int32_t ece391_shm_create (uint32_t key, uint32_t size);
+extern int32_t ece391_shm_attach (int32_t id, void* addr);
+extern int32_t ece391_shm_detach (void* addr);
+/* see ipc_data.h, recv returns the sender's pid */
+extern int32_t ece391_ipc_send (int32_t dest, ipc_msg_t* msg);
+extern int32_t ece391_ipc_recv (int32_t from, ipc_msg_t* msg);
+extern int32_t ece391_ipc_call (int32_t dest, ipc_msg_t* msg);
+extern int32_t ece391_getpid (void);
+/* vidmap into a RAM back buffer, shown on a timer until the first present */
+extern int32_t ece391_vidmap_buffered (uint8_t** screen_start);
+extern int32_t ece391_vidmap_present (void);
+/* see fb_data.h */
+extern int32_t ece391_fb_map (uint32_t width, uint32_t height, fb_info_t* info);
+extern int32_t ece391_fb_fill (const fb_rect_t* rect, uint32_t color);
+extern int32_t ece391_fb_blit (const fb_rect_t* rect);
+
+/* Raw entries through int 0x80 and sysenter, the wrappers above use the
+   vdso entry. ece391_sysenter_call is #UD unless ece391_has_sysenter () */
+extern int32_t ece391_int80_call (int32_t num, int32_t a, int32_t b, int32_t c);
+extern int32_t ece391_sysenter_call (int32_t num, int32_t a, int32_t b, int32_t c);
 
 enum signums {
 	DIV_ZERO = 0,
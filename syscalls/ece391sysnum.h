@@ -1,15 +1,15 @@
 #if !defined(ECE391SYSNUM_H)
 #define ECE391SYSNUM_H
 
-#define SYS_HALT    1
-#define SYS_EXECUTE 2
-#define SYS_READ    3
-#define SYS_WRITE   4
-#define SYS_OPEN    5
-#define SYS_CLOSE   6
-#define SYS_GETARGS 7
-#define SYS_VIDMAP  8
-#define SYS_SET_HANDLER  9
-#define SYS_SIGRETURN  10
+/* The call numbers come from the kernel's list of system calls */
+#include "../student-distrib/syscall_list.h"
+
+#if !defined(__ASSEMBLER__)
+#define SYSNUM_ENUM(num, NAME, name, handler) SYS_##NAME = num,
+enum sysnums {
+    SYSCALL_LIST(SYSNUM_ENUM)
+};
+#undef SYSNUM_ENUM
+#endif
 
 #endif /* ECE391SYSNUM_H */
@@ -0,0 +1,112 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "../student-distrib/sysstat_data.h"
+#include "../student-distrib/vdso_data.h"
+
+/*
+ * Prints system call counts and latency histograms. With no arguments it
+ * shows every running process, then the longest time the kernel kept
+ * interrupts off; "sysstat cmd args" runs the command and shows what it did
+ * once it exits.
+ */
+
+#define BUFSIZE 128
+#define NUMSIZE 16
+#define MAX_PIDS 6
+
+#define SYSCALL_NAME(num, NAME, name, handler) #name,
+static const char* names[NUM_SYSCALLS] = { SYSCALL_LIST(SYSCALL_NAME) };
+
+static sysstat_t stats;
+
+static void
+put (const char* s)
+{
+    ece391_fdputs (1, (const uint8_t*)s);
+}
+
+static void
+put_num (uint32_t value)
+{
+    uint8_t buf[NUMSIZE];
+
+    ece391_itoa (value, buf, 10);
+    ece391_fdputs (1, buf);
+}
+
+/* total / count without libgcc, saturates if the quotient needs 64 bits */
+static uint32_t
+average (uint64_t total, uint32_t count)
+{
+    uint32_t hi = (uint32_t)(total >> 32);
+    uint32_t lo = (uint32_t)total;
+    uint32_t quot, rem;
+
+    if (hi >= count)
+        return 0xFFFFFFFF;
+    asm ("divl %4" : "=a"(quot), "=d"(rem) : "a"(lo), "d"(hi), "rm"(count));
+    return quot;
+}
+
+static void
+print_stats (void)
+{
+    int32_t i, b;
+
+    put ((const char*)stats.cmd);
+    put (":\n");
+    for (i = 0; i < NUM_SYSCALLS; i++) {
+        syscall_stat_t* s = &stats.calls[i];
+        if (s->count == 0)
+            continue;
+        put ("  ");
+        put (names[i]);
+        put (" calls ");
+        put_num (s->count);
+        put (" errors ");
+        put_num (s->errors);
+        put (" avg ");
+        put_num (average (s->cycles, s->count));
+        put (" cycles\n    <2^8,^10,...:");
+        for (b = 0; b < SYSSTAT_BUCKETS; b++) {
+            put (" ");
+            put_num (s->hist[b]);
+        }
+        put ("\n");
+    }
+}
+
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint8_t where[IRQ_OFF_WHERE_LEN];
+    int32_t pid;
+
+    if (0 == ece391_getargs (buf, BUFSIZE)) {
+        if (-1 == ece391_execute (buf)) {
+            put ("no such command\n");
+            return 3;
+        }
+        if (-1 == ece391_sysstat (SYSSTAT_LAST_CHILD, &stats, sizeof (stats)))
+            return 3;
+        print_stats ();
+        return 0;
+    }
+
+    for (pid = 0; pid < MAX_PIDS; pid++) {
+        if (-1 == ece391_sysstat (pid, &stats, sizeof (stats)))
+            continue;
+        put ("pid ");
+        put_num (pid);
+        put (" ");
+        print_stats ();
+    }
+    put ("longest interrupts-off section: ");
+    put_num (ece391_irq_off_max (where));
+    put (" cycles in ");
+    put ((char*)where);
+    put ("\n");
+    return 0;
+}
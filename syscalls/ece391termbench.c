@@ -0,0 +1,82 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Terminal output benchmark, "termbench [file]". Reads the file (the long text
+ * file by default) and cats it to the screen REPS times, first one byte per
+ * write, which draws and moves the cursor once per character like the old
+ * terminal_write did, then one write per buffer the way cat does it. Prints
+ * the speed and the VGA port writes per megabyte of each.
+ */
+
+#define REPS 20
+#define BUFSIZE 8192
+#define NAMESIZE 33
+
+static uint8_t data[BUFSIZE];
+
+static void
+report (const char* name, uint32_t bytes, uint32_t ms, uint32_t ports)
+{
+    uint8_t buf[NAMESIZE];
+    uint32_t kb = bytes / 1024;
+
+    if (ms == 0)
+        ms = 1;
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (bytes, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" bytes in ");
+    ece391_itoa (ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" ms, ");
+    ece391_itoa ((bytes / 1024) * 1000 / ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" KB/s, ");
+    if (kb == 0)
+        kb = 1;
+    ece391_itoa (ports * 1024 / kb, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" port writes per MB\n");
+}
+
+int main ()
+{
+    uint8_t name[NAMESIZE];
+    int32_t fd, cnt, len, i, rep;
+    uint32_t start, per_byte, bulk, ports, per_byte_ports;
+
+    if (-1 == ece391_getargs (name, NAMESIZE))
+        ece391_strcpy (name, (uint8_t*)"verylargetextwithverylongname.tx");
+    if (-1 == (fd = ece391_open (name))) {
+        ece391_fdputs (1, (uint8_t*)"file not found\n");
+        return 2;
+    }
+    for (len = 0; len < BUFSIZE; len += cnt) {
+        if (0 >= (cnt = ece391_read (fd, data + len, BUFSIZE - len)))
+            break;
+    }
+    ece391_close (fd);
+
+    ports = ece391_vga_port_writes ();
+    start = ece391_time_ms ();
+    for (rep = 0; rep < REPS; rep++) {
+        for (i = 0; i < len; i++)
+            ece391_write (1, data + i, 1);
+    }
+    per_byte = ece391_time_ms () - start;
+    per_byte_ports = ece391_vga_port_writes () - ports;
+
+    ports = ece391_vga_port_writes ();
+    start = ece391_time_ms ();
+    for (rep = 0; rep < REPS; rep++)
+        ece391_write (1, data, len);
+    bulk = ece391_time_ms () - start;
+    ports = ece391_vga_port_writes () - ports;
+
+    report ("byte writes: ", len * REPS, per_byte, per_byte_ports);
+    report ("buffer writes: ", len * REPS, bulk, ports);
+    return 0;
+}
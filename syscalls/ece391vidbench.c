@@ -0,0 +1,130 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * vidmap benchmark, "vidbench". Loads the two fish frames and draws them in
+ * turn FRAMES times, first straight into text memory through vidmap the way
+ * fish does, then into a back buffer from vidmap_buffered with a present after
+ * every frame. Only the rows that differ between the frames are copied to the
+ * screen by a present, and a frame only shows up once it is complete. At the
+ * end the screen is mapped directly again and checked against the last frame
+ * presented.
+ */
+
+#define FRAMES 2000
+#define COLS 80
+#define ROWS 25
+#define ATTR 0x07
+#define NAMESIZE 33
+
+static uint8_t frames[2][ROWS][COLS];
+
+static void
+report (const char* name, uint32_t ms)
+{
+    uint8_t buf[NAMESIZE];
+
+    if (ms == 0)
+        ms = 1;
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (FRAMES, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" frames in ");
+    ece391_itoa (ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" ms, ");
+    ece391_itoa (FRAMES * 1000 / ms, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" frames/s\n");
+}
+
+static int32_t
+load (int32_t n, const char* name)
+{
+    int32_t fd, row = 0, col = 0;
+    uint8_t c;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)name)))
+        return -1;
+    while (row < ROWS && 1 == ece391_read (fd, &c, 1)) {
+        if (c == '\n') {
+            row++;
+            col = 0;
+        } else if (col < COLS) {
+            frames[n][row][col++] = c;
+        }
+    }
+    ece391_close (fd);
+    return 0;
+}
+
+static void
+draw (uint8_t* vmem, int32_t n)
+{
+    int32_t row, col;
+
+    for (row = 0; row < ROWS; row++) {
+        for (col = 0; col < COLS; col++) {
+            vmem[(row * COLS + col) * 2] = frames[n][row][col];
+            vmem[(row * COLS + col) * 2 + 1] = ATTR;
+        }
+    }
+}
+
+/* 1 if the text memory at vmem holds frame n */
+static int32_t
+shown (uint8_t* vmem, int32_t n)
+{
+    int32_t row, col;
+
+    for (row = 0; row < ROWS; row++) {
+        for (col = 0; col < COLS; col++) {
+            if (vmem[(row * COLS + col) * 2] != frames[n][row][col] ||
+                vmem[(row * COLS + col) * 2 + 1] != ATTR)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+int main ()
+{
+    uint8_t* vmem;
+    int32_t i, ok;
+    uint32_t start, direct, buffered;
+    uint8_t* cell = &frames[0][0][0];
+
+    for (i = 0; i < (int32_t)sizeof (frames); i++)
+        cell[i] = ' ';
+    if (-1 == load (0, "frame0.txt") || -1 == load (1, "frame1.txt")) {
+        ece391_fdputs (1, (uint8_t*)"frame files not found\n");
+        return 2;
+    }
+
+    if (-1 == ece391_vidmap (&vmem))
+        return 3;
+    start = ece391_time_ms ();
+    for (i = 0; i < FRAMES; i++)
+        draw (vmem, i & 1);
+    direct = ece391_time_ms () - start;
+
+    if (-1 == ece391_vidmap_buffered (&vmem))
+        return 3;
+    start = ece391_time_ms ();
+    for (i = 0; i < FRAMES; i++) {
+        draw (vmem, i & 1);
+        ece391_vidmap_present ();
+    }
+    buffered = ece391_time_ms () - start;
+
+    // a plain vidmap hands back text memory, which must show the last present
+    ok = -1 != ece391_vidmap (&vmem) && shown (vmem, (FRAMES - 1) & 1);
+
+    ece391_fdputs (1, (uint8_t*)"\n");
+    report ("direct vidmap: ", direct);
+    report ("back buffer + present: ", buffered);
+    ece391_fdputs (1, (uint8_t*)(ok ? "PASS\n" : "FAIL\n"));
+    return ok ? 0 : 1;
+}
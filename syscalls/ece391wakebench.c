@@ -0,0 +1,65 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/*
+ * Keystroke wakeup latency benchmark. Start counter on terminals 2 and 3,
+ * then run this on terminal 1 and press Enter SAMPLES times. After each line
+ * the kernel has timed how long it took from the Enter key until this
+ * process ran again; the average and worst case are printed at the end.
+ */
+
+#define SAMPLES 20
+#define BUFSIZE 128
+#define NUMSIZE 16
+#define US_PER_SEC 1000000
+#define CALIBRATE_DIV 100
+
+int main ()
+{
+    int32_t i;
+    uint32_t start_clock, start_tsc, cycles_per_us;
+    uint32_t count, last_count, latency, total, max;
+    uint8_t buf[BUFSIZE];
+
+    // TSC cycles per microsecond, measured against 10 ms of the kernel clock
+    start_clock = ece391_clock ();
+    start_tsc = ece391_rdtsc ();
+    while (ece391_clock () - start_clock < ece391_clock_freq () / CALIBRATE_DIV);
+    cycles_per_us = ece391_rdtsc () - start_tsc;
+    cycles_per_us /= US_PER_SEC / CALIBRATE_DIV;
+    if (cycles_per_us == 0)
+        cycles_per_us = 1;
+
+    ece391_fdputs (1, (uint8_t*)"press Enter ");
+    ece391_itoa (SAMPLES, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" times\n");
+
+    total = 0;
+    max = 0;
+    ece391_wake_latency (&last_count);
+    for (i = 0; i < SAMPLES; ) {
+        if (-1 == ece391_read (0, buf, BUFSIZE))
+            return 2;
+        latency = ece391_wake_latency (&count);
+        // lines that were typed ahead don't wake anyone
+        if (count == last_count)
+            continue;
+        last_count = count;
+        total += latency / cycles_per_us;
+        if (latency / cycles_per_us > max)
+            max = latency / cycles_per_us;
+        i++;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"wakeup latency: avg ");
+    ece391_itoa (total / SAMPLES, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" us, max ");
+    ece391_itoa (max, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" us\n");
+    return 0;
+}